@@ -0,0 +1,505 @@
+#include "BallWorldBatch.h"
+#include <algorithm>
+#include <cmath>
+
+// Copies are moved four at a time, one in each SSE lane
+constexpr size_t laneCount = 4;
+
+BallWorldBatch::BallWorldBatch(size_t worldCount, float ballRadius)
+    : worldCount{ worldCount }, stride{ (worldCount + laneCount - 1) / laneCount * laneCount }, ballRadius{ ballRadius },
+    gridTopLeft{ 0.0f,0.0f }, cellSize{ 1.0f,1.0f }, fill{ 1.0f }, columns{ 0 }, rows{ 0 }, initHealth{ 0 },
+    batWidth{ 0.0f }, batHeight{ 0.0f }, batY{ -INFINITY }, batMinX{ 0.0f }, batMaxX{ 0.0f }, batInverseMass{ 0.0f }, batFriction{ 0.0f }, lossY{ -INFINITY },
+    ballX(stride, 0.0f), ballY(stride, 0.0f), ballVX(stride, 0.0f), ballVY(stride, 0.0f), batX(stride, 0.0f), batVX(stride, 0.0f),
+    blocksLeft(stride, 0), lost(stride, 0) {
+    // The spare lanes at the end are never moved
+    for (size_t world = worldCount; world < stride; ++world)
+        lost[world] = 1;
+}
+
+void BallWorldBatch::addWall(const float2& p1, const float2& p2) {
+    float2 direction = p2 - p1;
+    walls.push_back(Wall{ p1,p2,normalise(float2{ -direction.y,direction.x }) });
+}
+
+void BallWorldBatch::setBlocks(const float2& topLeft, const float2& cellSize, unsigned int columns, unsigned int rows, float fill,
+    unsigned char initHealth) {
+    gridTopLeft = topLeft;
+    this->cellSize = cellSize;
+    this->columns = columns;
+    this->rows = rows;
+    this->fill = fill;
+    this->initHealth = initHealth;
+    health.assign(columns * rows * stride, initHealth);
+    for (size_t world = 0; world < worldCount; ++world)
+        blocksLeft[world] = initHealth ? columns * rows : 0;
+}
+
+void BallWorldBatch::setBat(float width, float height, float y, float minX, float maxX, float mass, float friction) {
+    batWidth = width;
+    batHeight = height;
+    batY = y;
+    batMinX = minX;
+    batMaxX = maxX;
+    batInverseMass = 1 / mass;
+    batFriction = friction;
+}
+
+void BallWorldBatch::reset(size_t world, const float2& ballLocation, const float2& ballVelocity, float batLeft) {
+    ballX[world] = ballLocation.x;
+    ballY[world] = ballLocation.y;
+    ballVX[world] = ballVelocity.x;
+    ballVY[world] = ballVelocity.y;
+    batX[world] = batLeft;
+    batVX[world] = 0.0f;
+    for (unsigned int cell = 0; cell < columns * rows; ++cell)
+        health[cell * stride + world] = initHealth;
+    blocksLeft[world] = initHealth ? columns * rows : 0;
+    lost[world] = 0;
+}
+
+unsigned char BallWorldBatch::getBlock(size_t world, unsigned int column, unsigned int row) const {
+    return static_cast<unsigned char>(health[(row * columns + column) * stride + world]);
+}
+
+void BallWorldBatch::tick([[maybe_unused]] bool inLanes) {
+    // Bats stop at the ends instead of going past them
+    for (size_t world = 0; world < worldCount; ++world)
+        batVX[world] = std::clamp(batX[world] + batVX[world], batMinX, batMaxX) - batX[world];
+
+#ifdef VECTOR_MATH_SSE
+    if (inLanes) {
+        for (size_t first = 0; first < stride; first += laneCount)
+            moveFourBalls(first);
+    } else
+#endif
+    for (size_t world = 0; world < worldCount; ++world) {
+        if (!finished(world))
+            moveBall(world, 1.0f, maxEventsPerTick);
+    }
+
+    for (size_t world = 0; world < worldCount; ++world) {
+        if (finished(world))
+            continue;
+        batX[world] += batVX[world];
+        if (ballY[world] < lossY)
+            lost[world] = 1;
+    }
+}
+
+bool BallWorldBatch::cellRange(const float2& low, const float2& high, unsigned int& firstColumn, unsigned int& lastColumn,
+    unsigned int& firstRow, unsigned int& lastRow) const {
+    if (columns == 0 || rows == 0)
+        return false;
+    // In cells from the top left of the grid, with rows counting down
+    float columnLow = std::floor((low.x - gridTopLeft.x) / cellSize.x) - 1;
+    float columnHigh = std::floor((high.x - gridTopLeft.x) / cellSize.x) + 1;
+    float rowLow = std::floor((gridTopLeft.y - high.y) / cellSize.y) - 1;
+    float rowHigh = std::floor((gridTopLeft.y - low.y) / cellSize.y) + 1;
+    if (!(columnHigh >= 0 && rowHigh >= 0 && columnLow < columns && rowLow < rows))
+        return false;
+    firstColumn = static_cast<unsigned int>(std::max(columnLow, 0.0f));
+    lastColumn = static_cast<unsigned int>(std::min(columnHigh, columns - 1.0f));
+    firstRow = static_cast<unsigned int>(std::max(rowLow, 0.0f));
+    lastRow = static_cast<unsigned int>(std::min(rowHigh, rows - 1.0f));
+    return true;
+}
+
+// Everything below is done in the same order, with the same operations, for one ball at a time and for four at once, so that a copy
+// moves the same whichever way it is moved
+
+// Keeps the sooner of 'best' and when a circle of 'radius' at p, moving at v, hits the front of the line from a to b, which faces
+// 'normal'. Circles already slightly into the line are hit straight away
+template <typename Hit>
+static void hitFace(const float2& p, const float2& v, const float2& a, const float2& b, const float2& normal, float radius, int what, Hit& best) {
+    float closing = -dotProduct(v, normal);
+    if (!(closing > 0))
+        return;
+    float distance = dotProduct(p - a, normal) - radius;
+    if (distance < -radius) // Behind the line
+        return;
+    float time = std::max(distance / closing, 0.0f);
+    if (!(time < best.time))
+        return;
+    float2 direction = b - a;
+    float along = dotProduct(p + v * time - a, direction);
+    if (along < 0 || along > dotProduct(direction, direction))
+        return;
+    best = { time,normal,what };
+}
+
+// The same, for hitting a circle of 'radius' around 'centre'
+template <typename Hit>
+static void hitCorner(const float2& p, const float2& v, const float2& centre, float radius, int what, Hit& best) {
+    float2 offset = p - centre;
+    float b = dotProduct(offset, v);
+    if (!(b < 0))
+        return;
+    float a = dotProduct(v, v);
+    float c = dotProduct(offset, offset) - radius * radius;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0)
+        return;
+    float time = std::max((-b - std::sqrt(discriminant)) / a, 0.0f);
+    if (!(time < best.time))
+        return;
+    best = { time,normalise(offset + v * time),what };
+}
+
+BallWorldBatch::Hit BallWorldBatch::findHit(size_t world, const float2& location, const float2& velocity, float timeLeft) const {
+    Hit hit = { timeLeft,{ 0.0f,0.0f },noHit };
+    for (auto& wall : walls) {
+        hitFace(location, velocity, wall.p1, wall.p2, wall.normal, ballRadius, hitWall, hit);
+        hitCorner(location, velocity, wall.p1, ballRadius, hitWall, hit);
+        hitCorner(location, velocity, wall.p2, ballRadius, hitWall, hit);
+    }
+
+    float2 travel = velocity * timeLeft;
+    float2 low = { std::min(location.x, location.x + travel.x) - ballRadius,std::min(location.y, location.y + travel.y) - ballRadius };
+    float2 high = { std::max(location.x, location.x + travel.x) + ballRadius,std::max(location.y, location.y + travel.y) + ballRadius };
+    unsigned int firstColumn, lastColumn, firstRow, lastRow;
+    if (cellRange(low, high, firstColumn, lastColumn, firstRow, lastRow)) {
+        float2 size = cellSize * fill;
+        float2 inset = { cellSize.x * (1 - fill) / 2,-cellSize.y * (1 - fill) / 2 };
+        for (unsigned int row = firstRow; row <= lastRow; ++row) {
+            for (unsigned int column = firstColumn; column <= lastColumn; ++column) {
+                int cell = row * columns + column;
+                if (!(health[cell * stride + world] > 0))
+                    continue;
+                float2 topLeft = gridTopLeft + float2{ column * cellSize.x,row * -cellSize.y } + inset;
+                float2 cellLow = { topLeft.x,topLeft.y - size.y };
+                float2 cellHigh = { topLeft.x + size.x,topLeft.y };
+                hitFace(location, velocity, { cellLow.x,cellHigh.y }, cellHigh, { 0.0f,1.0f }, ballRadius, cell, hit);
+                hitFace(location, velocity, cellHigh, { cellHigh.x,cellLow.y }, { 1.0f,0.0f }, ballRadius, cell, hit);
+                hitFace(location, velocity, { cellHigh.x,cellLow.y }, cellLow, { 0.0f,-1.0f }, ballRadius, cell, hit);
+                hitFace(location, velocity, cellLow, { cellLow.x,cellHigh.y }, { -1.0f,0.0f }, ballRadius, cell, hit);
+                hitCorner(location, velocity, { cellLow.x,cellHigh.y }, ballRadius, cell, hit);
+                hitCorner(location, velocity, cellHigh, ballRadius, cell, hit);
+                hitCorner(location, velocity, { cellHigh.x,cellLow.y }, ballRadius, cell, hit);
+                hitCorner(location, velocity, cellLow, ballRadius, cell, hit);
+            }
+        }
+    }
+
+    // The bat is where it will be after the part of the tick already gone, and moves relative to the ball
+    float batLeft = batX[world] + batVX[world] * (1 - timeLeft);
+    float2 left = { batLeft + batHeight / 2,batY - batHeight / 2 };
+    float2 right = { batLeft + batWidth - batHeight / 2,batY - batHeight / 2 };
+    float2 relativeVelocity = velocity - float2{ batVX[world],0.0f };
+    float reach = ballRadius + batHeight / 2;
+    hitFace(location, relativeVelocity, left, right, { 0.0f,1.0f }, reach, hitBat, hit);
+    hitFace(location, relativeVelocity, right, left, { 0.0f,-1.0f }, reach, hitBat, hit);
+    hitCorner(location, relativeVelocity, left, reach, hitBat, hit);
+    hitCorner(location, relativeVelocity, right, reach, hitBat, hit);
+    return hit;
+}
+
+// Walls and blocks can't move, so the ball bounces straight off them. The bat is bounced off as resolveContacts would for the ball hitting
+// it on its own, then stops where it is, as BatPhysics does. timeGone is how much of the tick had gone at the hit
+void BallWorldBatch::bounce(size_t world, const Hit& hit, float2& velocity, float timeGone) {
+    if (hit.what == hitBat) {
+        float2 batVelocity = { batVX[world],0.0f };
+        float2 normal = hit.normal;
+        float impulse = -2 * dotProduct(velocity - batVelocity, normal) / (1 + batInverseMass * normal.x * normal.x);
+        velocity += normal * impulse;
+        batVelocity.x -= batInverseMass * impulse * normal.x;
+        // Friction along the bat, as far as 'friction' of the way to them moving together
+        float2 difference = (batVelocity - normal * dotProduct(batVelocity, normal)) - (velocity - normal * dotProduct(velocity, normal));
+        float2 change = { difference.x * (1 + batInverseMass),difference.y };
+        float share = dotProduct(difference, change) / dotProduct(change, change);
+        if (!std::isnan(share))
+            velocity += difference * (batFriction * share);
+        batX[world] += batVX[world] * timeGone;
+        batVX[world] = 0.0f;
+    }
+    else {
+        velocity -= hit.normal * (2 * dotProduct(velocity, hit.normal));
+    }
+}
+
+void BallWorldBatch::hitBlock(size_t world, int cell) {
+    float& block = health[cell * stride + world];
+    block -= 1;
+    if (block == 0)
+        --blocksLeft[world];
+}
+
+void BallWorldBatch::moveBall(size_t world, float timeLeft, unsigned int eventsLeft) {
+    float2 location = { ballX[world],ballY[world] };
+    float2 velocity = { ballVX[world],ballVY[world] };
+    // Once out of collisions, the ball stays where it is for the rest of the tick
+    while (timeLeft > 0 && eventsLeft > 0) {
+        Hit hit = findHit(world, location, velocity, timeLeft);
+        location += velocity * hit.time;
+        timeLeft -= hit.time;
+        if (hit.what == noHit)
+            break;
+        --eventsLeft;
+        bounce(world, hit, velocity, 1 - timeLeft);
+        if (hit.what >= 0)
+            hitBlock(world, hit.what);
+    }
+    ballX[world] = location.x;
+    ballY[world] = location.y;
+    ballVX[world] = velocity.x;
+    ballVY[world] = velocity.y;
+}
+
+#ifdef VECTOR_MATH_SSE
+// a where mask is set, otherwise b
+static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// The soonest collisions found so far for four balls. 'what' is held as a float, so that it can be chosen between with the rest
+struct FourHits {
+    __m128 time;
+    __m128 normalX;
+    __m128 normalY;
+    __m128 what;
+};
+
+// Four balls, each at (px, py) moving at (vx, vy)
+struct FourBalls {
+    __m128 px;
+    __m128 py;
+    __m128 vx;
+    __m128 vy;
+};
+
+static inline void keepSooner(__m128 sooner, __m128 time, __m128 normalX, __m128 normalY, __m128 what, FourHits& best) {
+    best.time = select(sooner, time, best.time);
+    best.normalX = select(sooner, normalX, best.normalX);
+    best.normalY = select(sooner, normalY, best.normalY);
+    best.what = select(sooner, what, best.what);
+}
+
+// hitFace for the lanes in mask
+static void hitFaces(__m128 mask, const FourBalls& balls, __m128 ax, __m128 ay, __m128 bx, __m128 by, __m128 normalX, __m128 normalY,
+    __m128 radius, __m128 what, FourHits& best) {
+    const __m128 zero = _mm_setzero_ps();
+    __m128 closing = _mm_sub_ps(zero, _mm_add_ps(_mm_mul_ps(balls.vx, normalX), _mm_mul_ps(balls.vy, normalY)));
+    __m128 distance = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(balls.px, ax), normalX), _mm_mul_ps(_mm_sub_ps(balls.py, ay), normalY)), radius);
+    __m128 hit = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(closing, zero), _mm_cmpge_ps(distance, _mm_sub_ps(zero, radius))));
+    if (!_mm_movemask_ps(hit))
+        return;
+    __m128 time = _mm_max_ps(zero, _mm_div_ps(distance, closing));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(time, best.time));
+    __m128 directionX = _mm_sub_ps(bx, ax);
+    __m128 directionY = _mm_sub_ps(by, ay);
+    __m128 along = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_add_ps(balls.px, _mm_mul_ps(balls.vx, time)), ax), directionX),
+        _mm_mul_ps(_mm_sub_ps(_mm_add_ps(balls.py, _mm_mul_ps(balls.vy, time)), ay), directionY));
+    __m128 lengthSq = _mm_add_ps(_mm_mul_ps(directionX, directionX), _mm_mul_ps(directionY, directionY));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(along, zero), _mm_cmple_ps(along, lengthSq)));
+    keepSooner(hit, time, normalX, normalY, what, best);
+}
+
+// hitCorner for the lanes in mask
+static void hitCorners(__m128 mask, const FourBalls& balls, __m128 centreX, __m128 centreY, __m128 radius, __m128 what, FourHits& best) {
+    const __m128 zero = _mm_setzero_ps();
+    __m128 offsetX = _mm_sub_ps(balls.px, centreX);
+    __m128 offsetY = _mm_sub_ps(balls.py, centreY);
+    __m128 b = _mm_add_ps(_mm_mul_ps(offsetX, balls.vx), _mm_mul_ps(offsetY, balls.vy));
+    __m128 hit = _mm_and_ps(mask, _mm_cmplt_ps(b, zero));
+    if (!_mm_movemask_ps(hit))
+        return;
+    __m128 a = _mm_add_ps(_mm_mul_ps(balls.vx, balls.vx), _mm_mul_ps(balls.vy, balls.vy));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(radius, radius));
+    __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(discriminant, zero));
+    if (!_mm_movemask_ps(hit))
+        return;
+    __m128 time = _mm_max_ps(zero, _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(discriminant)), a));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(time, best.time));
+    if (!_mm_movemask_ps(hit))
+        return;
+    __m128 normalX = _mm_add_ps(offsetX, _mm_mul_ps(balls.vx, time));
+    __m128 normalY = _mm_add_ps(offsetY, _mm_mul_ps(balls.vy, time));
+    __m128 normalLengthSq = _mm_add_ps(_mm_mul_ps(normalX, normalX), _mm_mul_ps(normalY, normalY));
+    __m128 nonZero = _mm_cmpgt_ps(normalLengthSq, zero);
+    __m128 normalLength = _mm_sqrt_ps(normalLengthSq);
+    normalX = select(nonZero, _mm_div_ps(normalX, normalLength), normalX);
+    normalY = select(nonZero, _mm_div_ps(normalY, normalLength), normalY);
+    keepSooner(hit, time, normalX, normalY, what, best);
+}
+
+void BallWorldBatch::moveFourBalls(size_t first) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 minusTwo = _mm_set1_ps(-2.0f);
+    const __m128 inverseMass = _mm_set1_ps(batInverseMass);
+    const __m128 radius = _mm_set1_ps(ballRadius);
+    const __m128 wallHit = _mm_set1_ps(static_cast<float>(hitWall));
+    const __m128 batHit = _mm_set1_ps(static_cast<float>(hitBat));
+    const __m128 missed = _mm_set1_ps(static_cast<float>(noHit));
+    float timeLeft[laneCount];
+    for (size_t lane = 0; lane < laneCount; ++lane)
+        timeLeft[lane] = finished(first + lane) ? 0.0f : 1.0f;
+    __m128 time = _mm_loadu_ps(timeLeft);
+    if (!_mm_movemask_ps(_mm_cmpgt_ps(time, zero)))
+        return;
+
+    FourBalls balls = { _mm_loadu_ps(&ballX[first]),_mm_loadu_ps(&ballY[first]),_mm_loadu_ps(&ballVX[first]),_mm_loadu_ps(&ballVY[first]) };
+    __m128 batLeftStart = _mm_loadu_ps(&batX[first]);
+    __m128 batVelocity = _mm_loadu_ps(&batVX[first]);
+    float2 size = cellSize * fill;
+    float2 inset = { cellSize.x * (1 - fill) / 2,-cellSize.y * (1 - fill) / 2 };
+
+    for (unsigned int event = 0; event < lockStepEvents; ++event) {
+        __m128 going = _mm_cmpgt_ps(time, zero);
+        if (!_mm_movemask_ps(going))
+            break;
+        FourHits hit = { time,zero,zero,missed };
+
+        for (auto& wall : walls) {
+            __m128 ax = _mm_set1_ps(wall.p1.x);
+            __m128 ay = _mm_set1_ps(wall.p1.y);
+            __m128 bx = _mm_set1_ps(wall.p2.x);
+            __m128 by = _mm_set1_ps(wall.p2.y);
+            hitFaces(going, balls, ax, ay, bx, by, _mm_set1_ps(wall.normal.x), _mm_set1_ps(wall.normal.y), radius, wallHit, hit);
+            hitCorners(going, balls, ax, ay, radius, wallHit, hit);
+            hitCorners(going, balls, bx, by, radius, wallHit, hit);
+        }
+
+        // Each ball only looks at the cells near where it is going, as in findHit(), and only at blocks its copy still has. The cells
+        // near any of them are gone through together
+        float startX[laneCount], startY[laneCount], endX[laneCount], endY[laneCount];
+        _mm_storeu_ps(startX, balls.px);
+        _mm_storeu_ps(startY, balls.py);
+        _mm_storeu_ps(endX, _mm_add_ps(balls.px, _mm_mul_ps(balls.vx, time)));
+        _mm_storeu_ps(endY, _mm_add_ps(balls.py, _mm_mul_ps(balls.vy, time)));
+        int goingLanes = _mm_movemask_ps(going);
+        float firstColumns[laneCount], lastColumns[laneCount], firstRows[laneCount], lastRows[laneCount];
+        unsigned int firstColumn = columns, lastColumn = 0, firstRow = rows, lastRow = 0;
+        for (size_t lane = 0; lane < laneCount; ++lane) {
+            // An empty range unless the lane has one
+            firstColumns[lane] = 1;
+            lastColumns[lane] = 0;
+            firstRows[lane] = 0;
+            lastRows[lane] = 0;
+            if (!(goingLanes & (1 << lane)))
+                continue;
+            float2 low = { std::min(startX[lane], endX[lane]) - ballRadius,std::min(startY[lane], endY[lane]) - ballRadius };
+            float2 high = { std::max(startX[lane], endX[lane]) + ballRadius,std::max(startY[lane], endY[lane]) + ballRadius };
+            unsigned int laneFirstColumn, laneLastColumn, laneFirstRow, laneLastRow;
+            if (!cellRange(low, high, laneFirstColumn, laneLastColumn, laneFirstRow, laneLastRow))
+                continue;
+            firstColumns[lane] = static_cast<float>(laneFirstColumn);
+            lastColumns[lane] = static_cast<float>(laneLastColumn);
+            firstRows[lane] = static_cast<float>(laneFirstRow);
+            lastRows[lane] = static_cast<float>(laneLastRow);
+            firstColumn = std::min(firstColumn, laneFirstColumn);
+            lastColumn = std::max(lastColumn, laneLastColumn);
+            firstRow = std::min(firstRow, laneFirstRow);
+            lastRow = std::max(lastRow, laneLastRow);
+        }
+        if (firstColumn <= lastColumn && firstRow <= lastRow) {
+            __m128 firstColumnLanes = _mm_loadu_ps(firstColumns);
+            __m128 lastColumnLanes = _mm_loadu_ps(lastColumns);
+            __m128 firstRowLanes = _mm_loadu_ps(firstRows);
+            __m128 lastRowLanes = _mm_loadu_ps(lastRows);
+            for (unsigned int row = firstRow; row <= lastRow; ++row) {
+                __m128 rowLanes = _mm_set1_ps(static_cast<float>(row));
+                __m128 inRow = _mm_and_ps(_mm_cmpge_ps(rowLanes, firstRowLanes), _mm_cmple_ps(rowLanes, lastRowLanes));
+                for (unsigned int column = firstColumn; column <= lastColumn; ++column) {
+                    int cell = row * columns + column;
+                    __m128 columnLanes = _mm_set1_ps(static_cast<float>(column));
+                    __m128 near = _mm_and_ps(inRow, _mm_and_ps(_mm_cmpge_ps(columnLanes, firstColumnLanes), _mm_cmple_ps(columnLanes, lastColumnLanes)));
+                    __m128 solid = _mm_and_ps(near, _mm_cmpgt_ps(_mm_loadu_ps(&health[cell * stride + first]), zero));
+                    if (!_mm_movemask_ps(solid))
+                        continue;
+                    float2 topLeft = gridTopLeft + float2{ column * cellSize.x,row * -cellSize.y } + inset;
+                    __m128 lowX = _mm_set1_ps(topLeft.x);
+                    __m128 lowY = _mm_set1_ps(topLeft.y - size.y);
+                    __m128 highX = _mm_set1_ps(topLeft.x + size.x);
+                    __m128 highY = _mm_set1_ps(topLeft.y);
+                    __m128 what = _mm_set1_ps(static_cast<float>(cell));
+                    hitFaces(solid, balls, lowX, highY, highX, highY, zero, _mm_set1_ps(1.0f), radius, what, hit);
+                    hitFaces(solid, balls, highX, highY, highX, lowY, _mm_set1_ps(1.0f), zero, radius, what, hit);
+                    hitFaces(solid, balls, highX, lowY, lowX, lowY, zero, _mm_set1_ps(-1.0f), radius, what, hit);
+                    hitFaces(solid, balls, lowX, lowY, lowX, highY, _mm_set1_ps(-1.0f), zero, radius, what, hit);
+                    hitCorners(solid, balls, lowX, highY, radius, what, hit);
+                    hitCorners(solid, balls, highX, highY, radius, what, hit);
+                    hitCorners(solid, balls, highX, lowY, radius, what, hit);
+                    hitCorners(solid, balls, lowX, lowY, radius, what, hit);
+                }
+            }
+        }
+
+        // The bat, moving relative to the balls
+        __m128 batLeft = _mm_add_ps(batLeftStart, _mm_mul_ps(batVelocity, _mm_sub_ps(_mm_set1_ps(1.0f), time)));
+        __m128 batCentreY = _mm_set1_ps(batY - batHeight / 2);
+        __m128 leftX = _mm_add_ps(batLeft, _mm_set1_ps(batHeight / 2));
+        __m128 rightX = _mm_add_ps(batLeft, _mm_set1_ps(batWidth - batHeight / 2));
+        __m128 reach = _mm_set1_ps(ballRadius + batHeight / 2);
+        FourBalls relative = { balls.px,balls.py,_mm_sub_ps(balls.vx, batVelocity),_mm_sub_ps(balls.vy, zero) };
+        hitFaces(going, relative, leftX, batCentreY, rightX, batCentreY, zero, _mm_set1_ps(1.0f), reach, batHit, hit);
+        hitFaces(going, relative, rightX, batCentreY, leftX, batCentreY, zero, _mm_set1_ps(-1.0f), reach, batHit, hit);
+        hitCorners(going, relative, leftX, batCentreY, reach, batHit, hit);
+        hitCorners(going, relative, rightX, batCentreY, reach, batHit, hit);
+
+        // Step to the collision, or to the end of the tick for balls that don't hit anything
+        balls.px = _mm_add_ps(balls.px, _mm_mul_ps(balls.vx, hit.time));
+        balls.py = _mm_add_ps(balls.py, _mm_mul_ps(balls.vy, hit.time));
+        time = _mm_sub_ps(time, hit.time);
+        __m128 bounced = _mm_cmpneq_ps(hit.what, missed);
+        time = _mm_and_ps(time, bounced);
+
+        // Bounce, as in bounce()
+        __m128 speed = _mm_add_ps(_mm_mul_ps(balls.vx, hit.normalX), _mm_mul_ps(balls.vy, hit.normalY));
+        __m128 staticX = _mm_sub_ps(balls.vx, _mm_mul_ps(hit.normalX, _mm_mul_ps(two, speed)));
+        __m128 staticY = _mm_sub_ps(balls.vy, _mm_mul_ps(hit.normalY, _mm_mul_ps(two, speed)));
+        __m128 relativeX = _mm_sub_ps(balls.vx, batVelocity);
+        __m128 relativeY = _mm_sub_ps(balls.vy, zero);
+        __m128 denominator = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(inverseMass, hit.normalX), hit.normalX));
+        __m128 impulse = _mm_div_ps(_mm_mul_ps(minusTwo, _mm_add_ps(_mm_mul_ps(relativeX, hit.normalX), _mm_mul_ps(relativeY, hit.normalY))),
+            denominator);
+        __m128 bouncedX = _mm_add_ps(balls.vx, _mm_mul_ps(hit.normalX, impulse));
+        __m128 bouncedY = _mm_add_ps(balls.vy, _mm_mul_ps(hit.normalY, impulse));
+        __m128 pushedBat = _mm_sub_ps(batVelocity, _mm_mul_ps(_mm_mul_ps(inverseMass, impulse), hit.normalX));
+        __m128 batAlong = _mm_add_ps(_mm_mul_ps(pushedBat, hit.normalX), _mm_mul_ps(zero, hit.normalY));
+        __m128 ballAlong = _mm_add_ps(_mm_mul_ps(bouncedX, hit.normalX), _mm_mul_ps(bouncedY, hit.normalY));
+        __m128 differenceX = _mm_sub_ps(_mm_sub_ps(pushedBat, _mm_mul_ps(hit.normalX, batAlong)), _mm_sub_ps(bouncedX, _mm_mul_ps(hit.normalX, ballAlong)));
+        __m128 differenceY = _mm_sub_ps(_mm_sub_ps(zero, _mm_mul_ps(hit.normalY, batAlong)), _mm_sub_ps(bouncedY, _mm_mul_ps(hit.normalY, ballAlong)));
+        __m128 changeX = _mm_mul_ps(differenceX, _mm_add_ps(one, inverseMass));
+        __m128 changeY = differenceY;
+        __m128 share = _mm_div_ps(_mm_add_ps(_mm_mul_ps(differenceX, changeX), _mm_mul_ps(differenceY, changeY)),
+            _mm_add_ps(_mm_mul_ps(changeX, changeX), _mm_mul_ps(changeY, changeY)));
+        __m128 friction = _mm_mul_ps(_mm_set1_ps(batFriction), share);
+        __m128 notNaN = _mm_cmpord_ps(share, share);
+        bouncedX = select(notNaN, _mm_add_ps(bouncedX, _mm_mul_ps(differenceX, friction)), bouncedX);
+        bouncedY = select(notNaN, _mm_add_ps(bouncedY, _mm_mul_ps(differenceY, friction)), bouncedY);
+        __m128 onBat = _mm_cmpeq_ps(hit.what, batHit);
+        balls.vx = select(bounced, select(onBat, bouncedX, staticX), balls.vx);
+        balls.vy = select(bounced, select(onBat, bouncedY, staticY), balls.vy);
+        // Bats that were hit stop where they are
+        batLeftStart = select(onBat, _mm_add_ps(batLeftStart, _mm_mul_ps(batVelocity, _mm_sub_ps(one, time))), batLeftStart);
+        batVelocity = select(onBat, zero, batVelocity);
+
+        // Blocks are different in each copy, so they are damaged one lane at a time
+        int blockLanes = _mm_movemask_ps(_mm_cmpge_ps(hit.what, zero));
+        if (blockLanes) {
+            float what[laneCount];
+            _mm_storeu_ps(what, hit.what);
+            for (size_t lane = 0; lane < laneCount; ++lane) {
+                if (blockLanes & (1 << lane))
+                    hitBlock(first + lane, static_cast<int>(what[lane]));
+            }
+        }
+    }
+
+    _mm_storeu_ps(&ballX[first], balls.px);
+    _mm_storeu_ps(&ballY[first], balls.py);
+    _mm_storeu_ps(&ballVX[first], balls.vx);
+    _mm_storeu_ps(&ballVY[first], balls.vy);
+    _mm_storeu_ps(&batX[first], batLeftStart);
+    _mm_storeu_ps(&batVX[first], batVelocity);
+
+    // Balls with more collisions than the others in this tick are moved on their own, so that the rest don't wait for them
+    _mm_storeu_ps(timeLeft, time);
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+        if (timeLeft[lane] > 0)
+            moveBall(first + lane, timeLeft[lane], maxEventsPerTick - lockStepEvents);
+    }
+}
+#endif
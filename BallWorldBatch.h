@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "VectorMath.h"
+
+// Many copies of one breakout level, each with its own ball, bat and blocks, stepped together in lock step so that each SSE lane is a
+// different copy. Meant for running thousands of games with different inputs, e.g. for training or balancing, where a CollisionWorld
+// for each would be too slow. The walls and the layout of the blocks are the same in every copy, so only what differs between them is
+// kept, as one array across the copies for each property. Copies needing more collisions in a tick than the others are finished off
+// one at a time, so that they don't hold the rest of their lanes up
+class BallWorldBatch {
+	// A wall, collided with from the side that p2 is clockwise from p1, as with LineAndCircleBoundedCollidable::addLine
+	struct Wall {
+		float2 p1;
+		float2 p2;
+		float2 normal; // Unit direction out of the wall
+	};
+
+	// The soonest collision found so far for one ball
+	struct Hit {
+		float time;
+		float2 normal; // Unit direction the ball is pushed in
+		int what; // Index of the block's cell, or hitWall, hitBat or noHit
+	};
+
+	size_t worldCount;
+	size_t stride; // worldCount rounded up to a whole number of lanes, so that the arrays can always be loaded four at a time
+	float ballRadius;
+	std::vector<Wall> walls;
+	// The blocks, as a grid of cells like LineAndCircleBoundedCollidable::makeTileGrid
+	float2 gridTopLeft;
+	float2 cellSize;
+	float fill;
+	unsigned int columns;
+	unsigned int rows;
+	unsigned char initHealth;
+	// The bat is a capsule along the bottom of the level, moved left and right. It bounces balls as BatPhysics does in a CollisionWorld:
+	// it can be pushed sideways but not up or down, and stops moving when it is hit
+	float batWidth;
+	float batHeight;
+	float batY; // Top of the bat
+	float batMinX; // Furthest left and right that the bat's left side can go
+	float batMaxX;
+	float batInverseMass; // Sideways, with the ball's mass as 1
+	float batFriction; // How much of the way a bounce goes to the ball and bat moving together along the bat
+	float lossY; // A ball below this has been lost
+	// Each of these has one entry for each copy, in stride entries
+	std::vector<float> ballX;
+	std::vector<float> ballY;
+	std::vector<float> ballVX;
+	std::vector<float> ballVY;
+	std::vector<float> batX; // Left side of the bat
+	std::vector<float> batVX;
+	std::vector<float> health; // Of each block, cell by cell with stride entries each. float so that four copies' can be compared at once
+	std::vector<unsigned int> blocksLeft;
+	std::vector<unsigned char> lost;
+
+	static constexpr int hitWall = -1;
+	static constexpr int hitBat = -2;
+	static constexpr int noHit = -3;
+
+	bool finished(size_t world) const { return lost[world] || blocksLeft[world] == 0; }
+	// The cells that a ball could hit within the box, with a cell to spare for rounding. False if there aren't any
+	bool cellRange(const float2& low, const float2& high, unsigned int& firstColumn, unsigned int& lastColumn, unsigned int& firstRow,
+		unsigned int& lastRow) const;
+	Hit findHit(size_t world, const float2& location, const float2& velocity, float timeLeft) const;
+	void bounce(size_t world, const Hit& hit, float2& velocity, float timeGone);
+	void hitBlock(size_t world, int cell);
+	// Moves a ball through the rest of the tick on its own, with up to eventsLeft collisions
+	void moveBall(size_t world, float timeLeft, unsigned int eventsLeft);
+	// Moves the balls of copies first to first + 3 together, then any with collisions left over on their own
+	void moveFourBalls(size_t first);
+public:
+	// Most collisions a ball can have in one tick. Any left over are put off by stopping the ball for the rest of the tick
+	static constexpr unsigned int maxEventsPerTick = 16;
+	// Collisions in a tick that the four balls in a group are moved through together before the ones still going are moved on their own
+	static constexpr unsigned int lockStepEvents = 4;
+
+	BallWorldBatch(size_t worldCount, float ballRadius);
+	void addWall(const float2& p1, const float2& p2);
+	// Blocks in a grid of columns x rows cells of size cellSize, with its top left corner at topLeft. The solid part of a cell is scaled
+	// by fill about the cell's centre. Every block starts with 'initHealth', and is gone when it has been hit that many times
+	void setBlocks(const float2& topLeft, const float2& cellSize, unsigned int columns, unsigned int rows, float fill, unsigned char initHealth);
+	// A bat with its top at y, which can move between minX and maxX. 'mass' is relative to the ball's. 'friction' is 1 minus the product
+	// of the ball's and the bat's getCorFactorTang() in a CollisionWorld
+	void setBat(float width, float height, float y, float minX, float maxX, float mass, float friction);
+	void setLossY(float y) { lossY = y; }
+	// Starts a copy again, with every block back
+	void reset(size_t world, const float2& ballLocation, const float2& ballVelocity, float batLeft);
+	// The bat keeps this velocity until it is changed, the ball hits it or it gets to an end
+	void setBatVelocity(size_t world, float velocity) { batVX[world] = velocity; }
+	// Moves every copy that hasn't finished forward one tick. With inLanes false each copy is moved on its own without SSE, which is
+	// slower but should give the same results, to check the lanes against
+	void tick(bool inLanes = true);
+	size_t size() const { return worldCount; }
+	float2 getBallLocation(size_t world) const { return { ballX[world],ballY[world] }; }
+	float2 getBallVelocity(size_t world) const { return { ballVX[world],ballVY[world] }; }
+	float getBatLeft(size_t world) const { return batX[world]; }
+	unsigned int getBlocksLeft(size_t world) const { return blocksLeft[world]; }
+	unsigned char getBlock(size_t world, unsigned int column, unsigned int row) const;
+	bool isBallLost(size_t world) const { return lost[world] != 0; }
+	// A copy has finished once it has no blocks left or has lost its ball, and isn't moved again until it is reset
+	bool isFinished(size_t world) const { return finished(world); }
+};
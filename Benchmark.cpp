@@ -0,0 +1,388 @@
+#include "Game.h"
+#include "BallWorldBatch.h"
+#include "RollbackBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Times the collision engine on named scenarios, a tick at a time through CollisionWorld::doTickOfCollisions, and prints the results as JSON
+// so that they can be compared across builds. Built with NullDisplaySystem.cpp, so the game's objects can be used without a window
+//   -ticks N        Runs every scenario for N ticks instead of its own number
+//   -scenario NAME  Only runs the named scenario
+
+// Moves the bat towards centring itself on x, as a player holding left or right would
+static void steerTowards(BatPhysics& bat, float x) {
+    float offset = x - (bat.getLocation().x + bat.getWidth() / 2);
+    bat.steer(offset > 0.01f ? 1 : offset < -0.01f ? -1 : 0);
+}
+
+// A level to be timed, set up in the constructor. Anything the game would do between ticks goes in betweenTicks, which isn't timed
+class Scenario {
+public:
+    CollisionWorld world; // First, so that it is destroyed after everything in it
+    ParticleSystem fragments{ { 0.0f,-0.0005f }, 0.5f, 4 }; // Only for BrickField, never ticked
+    unsigned int games = 1; // Copies of the game moved on by each tick
+    bool ticksWorld = true; // False if tick doesn't use 'world', which then has no events or narrow phase tests to report
+
+    virtual ~Scenario() = default;
+    virtual void betweenTicks(unsigned int /*tick*/) {}
+    // The part that is timed
+    virtual void tick() { world.doTickOfCollisions(); }
+    // Anything else to report, as JSON fields each starting with a comma
+    virtual std::string extraResults() const { return {}; }
+};
+
+// The left, right and top walls of the game, and a floor if 'closed'
+static void addWalls(Walls& walls, bool closed) {
+    Rect temp = getRect(20, 1, 0, 0, 1.0f);
+    for (Rect rect : { getRect(20, 1, 0, 0, 1.0f), getRect(20, 1, 19, 0, 1.0f), getRect(1, 20, 0, 0, 1.0f, { temp.x + temp.w,1.0f ,2.0f * 18.0f / 20.0f,2.0f }) })
+        walls.add(rect);
+    if (closed)
+        walls.add(Rect{ -1.0f, -0.9f, 2.0f, 0.1f });
+    walls.bake();
+}
+
+// The game's level, with the bat following the ball. A ball that gets past the bat starts again, and the bricks are put back once all
+// are broken. With 'unbreakable' bricks the ball is kept in play between the bat and the bricks for as long as it runs
+class RallyScenario : public Scenario {
+    Walls walls{ world };
+    BrickField bricks;
+    BatPhysics bat{ world, Rect{ -0.1f, -0.84f, 0.2f, 0.05f } };
+    BallPhysics ball{ world, { 0.0f,-0.5f }, { -0.01f,-0.01f }, 0.025f, 1.0f };
+public:
+    explicit RallyScenario(bool unbreakable)
+        : bricks{ world, Rect{ -0.9f, 0.72f, 1.8f, 0.72f }, 10, 8, 0.9f, static_cast<unsigned char>(unbreakable ? 255 : 1), fragments, 1 } {
+        addWalls(walls, false);
+        world.sortStorageSpatially();
+    }
+
+    void betweenTicks(unsigned int) override {
+        float2 location = ball.getLocation();
+        if (std::fmax(std::abs(location.x), std::abs(location.y)) > 1.0f)
+            ball.changeTrajectory({ 0.0f,-0.5f }, { -0.01f,-0.01f });
+        if (bricks.empty())
+            bricks.refill();
+        steerTowards(bat, location.x);
+        fragments.clear();
+    }
+
+    float2 getBallLocation() { return ball.getLocation(); }
+    float getBatLeft() { return bat.getLocation().x; }
+    float getBatVelocity() { return bat.getVelocity().x; }
+};
+
+// A closed box of balls moving in random directions, 'columns' by 'rows' of them spaced evenly across 'area'. Balls that somehow escape
+// are put back in the middle
+class BallsScenario : public Scenario {
+    Walls walls{ world };
+    std::list<BallPhysics> balls;
+public:
+    BallsScenario(Rect area, unsigned int columns, unsigned int rows, float radius, float speed) {
+        addWalls(walls, true);
+        std::minstd_rand random{ 1 };
+        std::uniform_real_distribution<float> velocity{ -speed,speed };
+        for (unsigned int row = 0; row < rows; ++row) {
+            for (unsigned int column = 0; column < columns; ++column) {
+                Rect cell = getRect(columns, rows, column, row, 1.0f, area);
+                balls.emplace_back(world, float2{ cell.x + cell.w / 2,cell.y - cell.h / 2 }, float2{ velocity(random),velocity(random) }, radius, 1.0f);
+            }
+        }
+        world.sortStorageSpatially();
+    }
+
+    void betweenTicks(unsigned int) override {
+        for (auto& ball : balls) {
+            float2 location = ball.getLocation();
+            if (std::fmax(std::abs(location.x), std::abs(location.y)) > 1.0f)
+                ball.changeTrajectory({ 0.0f,0.0f }, ball.getVelocity());
+        }
+    }
+};
+
+// BallsScenario for netplay with a few ticks of delay: each tick is done, saved, and then the last 'ticks' ticks are rolled back and done
+// again, as they would be when a late input arrived every tick. The inputs are the same again, as that costs the same. The rollback and
+// saves are also timed apart from the ticks, as RollbackBuffer::resimulate would do them
+class RollbackScenario : public BallsScenario {
+    RollbackBuffer rollback;
+    unsigned int ticks;
+    double rollbackMicroseconds = 0;
+    unsigned int rollbacks = 0;
+public:
+    RollbackScenario(Rect area, unsigned int columns, unsigned int rows, float radius, float speed, unsigned int ticks)
+        : BallsScenario{ area, columns, rows, radius, speed }, rollback{ ticks + 1 }, ticks{ ticks } {}
+
+    void tick() override {
+        world.doTickOfCollisions();
+        rollback.save(world);
+        if (rollback.size() <= ticks)
+            return;
+        auto start = std::chrono::steady_clock::now();
+        rollback.rollback(world, ticks);
+        std::chrono::duration<double, std::micro> taken = std::chrono::steady_clock::now() - start;
+        for (unsigned int tick = 0; tick < ticks; ++tick) {
+            world.doTickOfCollisions();
+            start = std::chrono::steady_clock::now();
+            rollback.save(world);
+            taken += std::chrono::steady_clock::now() - start;
+        }
+        rollbackMicroseconds += taken.count();
+        ++rollbacks;
+    }
+
+    std::string extraResults() const override {
+        return ", \"rollbackAndSavesMicroseconds\": " + std::to_string(rollbacks ? rollbackMicroseconds / rollbacks : 0.0)
+            + ", \"bytesPerSavedTick\": " + std::to_string(rollback.newestSize());
+    }
+};
+
+// A closed box with 125 by 80 bricks, broken by a few fast balls
+class ManyBricksScenario : public Scenario {
+    Walls walls{ world };
+    BrickField bricks{ world, Rect{ -0.9f, 0.9f, 1.8f, 1.2f }, 125, 80, 0.9f, 1, fragments, 1 };
+    std::list<BallPhysics> balls;
+public:
+    ManyBricksScenario() {
+        addWalls(walls, true);
+        for (int i = 0; i < 16; ++i)
+            balls.emplace_back(world, float2{ -0.8f + 0.1f * i,-0.6f }, float2{ i % 2 ? 0.013f : -0.011f,0.02f }, 0.01f, 1.0f);
+        world.sortStorageSpatially();
+    }
+
+    void betweenTicks(unsigned int) override {
+        if (bricks.empty())
+            bricks.refill();
+        fragments.clear();
+    }
+};
+
+// The bat held against a ball that is against the left wall, which the collision loop has to keep resolving without letting either
+// through. Everything is put back every 200 ticks, in case the ball squeezes out
+class SqueezeScenario : public Scenario {
+    Walls walls{ world };
+    static constexpr Rect batStart = { -0.6f, -0.84f, 0.2f, 0.05f };
+    BatPhysics bat{ world, batStart };
+    BallPhysics ball{ world, { -0.875f,-0.865f }, { 0.0f,0.0f }, 0.025f, 1.0f };
+public:
+    SqueezeScenario() {
+        addWalls(walls, true);
+        world.sortStorageSpatially();
+    }
+
+    void betweenTicks(unsigned int tick) override {
+        if (tick % 200 == 0) {
+            bat.changeTrajectory({ batStart.x,batStart.y }, { 0.0f,0.0f });
+            ball.changeTrajectory({ -0.875f,-0.865f }, { 0.0f,0.0f });
+        }
+        steerTowards(bat, -1.0f);
+    }
+};
+
+// The game's level as a BallWorldBatch of 'copies' copies, each with its bat following its ball, and started again with the ball somewhere
+// else once it is finished. 'world' isn't used, so events and narrow phase tests aren't reported. Between ticks, the batch is
+// checked two ways, throwing if either is wrong:
+// - Every copy has to match a second batch moved one copy at a time without SSE exactly
+// - For the first trackedTicks ticks, copy 0 has to stay within 'tolerance' of the same game in a CollisionWorld, with its bat steered
+//   as that game's is. After that the two are let go, as a ball grazing the bat or the corner of a block can turn rounding into a
+//   different bounce
+class BatchScenario : public Scenario {
+    static constexpr float ballRadius = 0.025f;
+    static constexpr float batWidth = 0.2f;
+    static constexpr unsigned int trackedTicks = 900;
+    static constexpr float tolerance = 1e-3f;
+    BallWorldBatch batch;
+    BallWorldBatch oneAtATime;
+    RallyScenario stock{ false };
+    std::minstd_rand random{ 1 };
+
+    static void setUp(BallWorldBatch& level) {
+        Rect temp = getRect(20, 1, 0, 0, 1.0f);
+        for (Rect rect : { getRect(20, 1, 0, 0, 1.0f), getRect(20, 1, 19, 0, 1.0f), getRect(1, 20, 0, 0, 1.0f, { temp.x + temp.w,1.0f ,2.0f * 18.0f / 20.0f,2.0f }) }) {
+            // Clockwise from the top left, as Walls adds them
+            float2 corners[4] = { { rect.x,rect.y },{ rect.x + rect.w,rect.y },{ rect.x + rect.w,rect.y - rect.h },{ rect.x,rect.y - rect.h } };
+            for (int i = 0; i < 4; ++i)
+                level.addWall(corners[i], corners[(i + 1) % 4]);
+        }
+        level.setBlocks({ -0.9f,0.72f }, { 0.18f,0.09f }, 10, 8, 0.9f, 1);
+        // BatPhysics has the ball's mass, and a tangential COR factor of 0.5 against the ball's 1
+        level.setBat(batWidth, 0.05f, -0.84f, -0.9f, 0.9f - batWidth, 1.0f, 0.5f);
+        level.setLossY(-1.0f);
+    }
+
+    // Starts a copy again in both batches, with the stock level's start for copy 0
+    void restart(size_t copy) {
+        std::uniform_real_distribution<float> across{ -0.5f,0.5f };
+        std::uniform_real_distribution<float> sideways{ -0.01f,0.01f };
+        float2 location = { 0.0f,-0.5f };
+        float2 velocity = { -0.01f,-0.01f };
+        if (copy != 0) {
+            location.x = across(random);
+            velocity.x = sideways(random);
+        }
+        batch.reset(copy, location, velocity, -0.1f);
+        oneAtATime.reset(copy, location, velocity, -0.1f);
+    }
+
+    // As steerTowards
+    static void steer(BallWorldBatch& level, size_t copy) {
+        float offset = level.getBallLocation(copy).x - (level.getBatLeft(copy) + batWidth / 2);
+        level.setBatVelocity(copy, offset > 0.01f ? BatPhysics::speed : offset < -0.01f ? -BatPhysics::speed : 0.0f);
+    }
+
+    void checkOneAtATime(unsigned int tick) const {
+        for (size_t copy = 0; copy < batch.size(); ++copy) {
+            float2 ball = batch.getBallLocation(copy);
+            float2 other = oneAtATime.getBallLocation(copy);
+            if (std::memcmp(&ball, &other, sizeof(ball)) != 0 || batch.getBatLeft(copy) != oneAtATime.getBatLeft(copy)
+                || batch.getBlocksLeft(copy) != oneAtATime.getBlocksLeft(copy) || batch.isBallLost(copy) != oneAtATime.isBallLost(copy))
+                throw "Copy " + std::to_string(copy) + " of the batch moved differently on its own by tick " + std::to_string(tick);
+        }
+    }
+
+    void checkTracking(unsigned int tick) {
+        float2 offset = stock.getBallLocation() - batch.getBallLocation(0);
+        float batOffset = stock.getBatLeft() - batch.getBatLeft(0);
+        if (!(std::sqrt(dotProduct(offset, offset)) <= tolerance && std::abs(batOffset) <= tolerance))
+            throw "The batch lost track of the CollisionWorld game at tick " + std::to_string(tick) + ", with the ball "
+                + std::to_string(std::sqrt(dotProduct(offset, offset))) + " and the bat " + std::to_string(batOffset) + " away";
+    }
+public:
+    explicit BatchScenario(size_t copies) : batch{ copies,ballRadius }, oneAtATime{ copies,ballRadius } {
+        games = static_cast<unsigned int>(copies);
+        ticksWorld = false;
+        setUp(batch);
+        setUp(oneAtATime);
+        for (size_t copy = 0; copy < copies; ++copy)
+            restart(copy);
+    }
+
+    void betweenTicks(unsigned int tick) override {
+        checkOneAtATime(tick);
+        for (size_t copy = 0; copy < batch.size(); ++copy) {
+            if (batch.isFinished(copy) && !(copy == 0 && tick <= trackedTicks))
+                restart(copy);
+            steer(batch, copy);
+            steer(oneAtATime, copy);
+        }
+        if (tick <= trackedTicks) {
+            checkTracking(tick);
+            stock.betweenTicks(tick);
+            batch.setBatVelocity(0, stock.getBatVelocity());
+            oneAtATime.setBatVelocity(0, stock.getBatVelocity());
+            stock.tick();
+        }
+        oneAtATime.tick(false);
+    }
+
+    void tick() override { batch.tick(); }
+};
+
+struct ScenarioType {
+    const char* name;
+    unsigned int ticks;
+    std::function<std::unique_ptr<Scenario>()> make;
+};
+
+static const ScenarioType scenarioTypes[] = {
+    { "stock", 20000, [] { return std::make_unique<RallyScenario>(false); } },
+    { "bricks10k", 5000, [] { return std::make_unique<ManyBricksScenario>(); } },
+    { "balls1k", 500, [] { return std::make_unique<BallsScenario>(Rect{ -0.85f, 0.85f, 1.7f, 1.7f }, 40, 25, 0.01f, 0.01f); } },
+    { "denseMultiball", 2000, [] { return std::make_unique<BallsScenario>(Rect{ -0.85f, 0.0f, 1.7f, 0.85f }, 20, 10, 0.02f, 0.02f); } },
+    { "squeeze", 5000, [] { return std::make_unique<SqueezeScenario>(); } },
+    { "longRally", 200000, [] { return std::make_unique<RallyScenario>(true); } },
+    { "rollback8x1k", 50, [] { return std::make_unique<RollbackScenario>(Rect{ -0.85f, 0.85f, 1.7f, 1.7f }, 40, 25, 0.01f, 0.01f, 8); } },
+    { "batch1k", 2000, [] { return std::make_unique<BatchScenario>(1024); } },
+};
+
+// Ticks run before timing starts, so that neighbour lists and memory pools have settled
+constexpr unsigned int warmupTicks = 100;
+
+// Runs the scenario and prints its results as a JSON object
+static void runScenario(const ScenarioType& type, unsigned int ticks) {
+    std::unique_ptr<Scenario> scenario = type.make();
+    CollisionWorld& world = scenario->world;
+    for (unsigned int tick = 0; tick < warmupTicks; ++tick) {
+        scenario->betweenTicks(tick);
+        scenario->tick();
+    }
+
+    CollisionStatistics before = world.getStatistics();
+    std::vector<double> tickTimes(ticks);
+    double total = 0;
+    for (unsigned int tick = 0; tick < ticks; ++tick) {
+        scenario->betweenTicks(warmupTicks + tick);
+        auto start = std::chrono::steady_clock::now();
+        scenario->tick();
+        std::chrono::duration<double, std::micro> taken = std::chrono::steady_clock::now() - start;
+        tickTimes[tick] = taken.count();
+        total += taken.count();
+    }
+    const CollisionStatistics& after = world.getStatistics();
+
+    char work[128] = "";
+    if (scenario->ticksWorld) {
+        std::snprintf(work, sizeof(work), " \"eventsPerTick\": %.3f, \"narrowPhaseTestsPerTick\": %.3f,",
+            static_cast<double>(after.totalEvents - before.totalEvents) / ticks, static_cast<double>(after.pairTests - before.pairTests) / ticks);
+    }
+
+    std::sort(tickTimes.begin(), tickTimes.end());
+    std::printf("    { \"name\": \"%s\", \"ticks\": %u, \"ticksPerSecond\": %.1f, \"gameTicksPerSecond\": %.1f,%s "
+        "\"p50TickMicroseconds\": %.3f, \"p99TickMicroseconds\": %.3f%s }", type.name, ticks, ticks / total * 1e6,
+        static_cast<double>(ticks) * scenario->games / total * 1e6, work, tickTimes[ticks / 2], tickTimes[std::min<size_t>(ticks - 1, ticks * 99ull / 100)],
+        scenario->extraResults().c_str());
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int ticks = 0;
+    const char* only = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "-ticks") == 0)
+            ticks = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (i + 1 < argc && std::strcmp(argv[i], "-scenario") == 0)
+            only = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: %s [-ticks N] [-scenario NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (only && std::none_of(std::begin(scenarioTypes), std::end(scenarioTypes), [&](const ScenarioType& type) { return std::strcmp(type.name, only) == 0; })) {
+        std::fprintf(stderr, "No scenario called %s\n", only);
+        return 2;
+    }
+
+    try {
+        std::printf("{\n  \"scenarios\": [\n");
+        bool first = true;
+        for (auto& type : scenarioTypes) {
+            if (only && std::strcmp(type.name, only) != 0)
+                continue;
+            if (!first)
+                std::printf(",\n");
+            first = false;
+            runScenario(type, ticks ? ticks : type.ticks);
+            std::fflush(stdout);
+        }
+        std::printf("\n  ]\n}\n");
+    }
+    catch (const char* message) {
+        std::fprintf(stderr, "%s\n", message);
+        return 1;
+    }
+    catch (const std::string& message) {
+        std::fprintf(stderr, "%s\n", message.c_str());
+        return 1;
+    }
+    catch (const std::exception& exception) {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+    return 0;
+}
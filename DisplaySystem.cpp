@@ -13,6 +13,7 @@ namespace DisplaySystem {
 
     class Sprite;
     static std::unordered_map<std::string, Sprite> sprites;
+    static std::unordered_map<std::string, Sprite> manySprites; // Used by showMany(), kept apart so that VisualComponents aren't overwritten
 
     /// Manages an openGL buffer with data for where to display instances of an image.
     class Sprite {
@@ -149,6 +150,25 @@ namespace DisplaySystem {
             *(ptr + 4 * index + 3) = h;
             glUnmapNamedBuffer(bufferID);
         }
+        // Replaces every location at which the image is displayed, all with the same dimensions. Only for Sprites not used by VisualComponents
+        void setElements(const float* x, const float* y, unsigned int count, float w, float h) {
+            if (allocatedSize < count) {
+                while (allocatedSize < count)
+                    allocatedSize *= 2;
+                glNamedBufferData(bufferID, allocatedSize * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW); // Nothing old needs keeping
+            }
+            if (count) {
+                float* ptr = static_cast<float*>(glMapNamedBufferRange(bufferID, 0, count * 4 * sizeof(float), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+                for (unsigned int i = 0; i < count; ++i) {
+                    *(ptr + i * 4) = x[i];
+                    *(ptr + i * 4 + 1) = y[i];
+                    *(ptr + i * 4 + 2) = w;
+                    *(ptr + i * 4 + 3) = h;
+                }
+                glUnmapNamedBuffer(bufferID);
+            }
+            size = count;
+        }
         // Draws the image onto the screen at all the locations given in the buffer. Needs correct shader program to be bound
         void draw() {
             // Could record and rebind previously bound texture and vao to improve code safety
@@ -246,12 +266,20 @@ namespace DisplaySystem {
         for (auto& sprite : sprites) {
             sprite.second.draw();
         }
+        for (auto& sprite : manySprites) {
+            sprite.second.draw();
+        }
 
         glUseProgram(NULL); // Could rebind previous bound program
 
         SwapBuffers(deviceContext);
     }
 
+    void showMany(std::string imagePath, const float* x, const float* y, size_t count, float w, float h) {
+        manySprites.try_emplace(imagePath, imagePath);
+        manySprites.at(imagePath).setElements(x, y, static_cast<unsigned int>(count), w, h);
+    }
+
     // Copied from https://www.khronos.org/opengl/wiki/Load_OpenGL_Functions
     void* GetAnyGLFuncAddress(const char* name)
     {
@@ -371,6 +399,7 @@ namespace DisplaySystem {
     void cleanup() {
         // Need to empty the 'sprites' container for the Sprite destructors before deleting openGL context
         sprites.clear(); // VisualComponents should to be destroyed before this
+        manySprites.clear();
         wglMakeCurrent(deviceContext, NULL);
         wglDeleteContext(context);
     }
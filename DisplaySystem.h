@@ -1,7 +1,9 @@
 #pragma once
 #include <string>
+#ifdef _WIN32
 #include <Windows.h>	// Only needed for HWND typedef
 #include <glad/glad.h>	// Only needed for GLint and GLsizei typedef
+#endif
 
 // Used to display 2D graphics
 namespace DisplaySystem {
@@ -9,12 +11,18 @@ namespace DisplaySystem {
 	// Updates the display to show all of the current VisualComponents
 	void update();
 
+#ifdef _WIN32
 	// Needs to be run before anything in DisplaySystem is used
 	void init(HWND windowHandle, GLint x, GLint y, GLsizei windowWidth, GLsizei windowHeight);
+#endif
 
 	// Should be run before the end of the program. All VisualComponents should be destroyed before this.
 	void cleanup();
 
+	// Displays the image at 'count' top-left-corner locations (x[i],y[i]), all with width 'w' and height 'h', replacing those from the last call
+	// for the same image. Meant for large numbers of small things that move every frame, e.g. particles
+	void showMany(std::string imagePath, const float* x, const float* y, size_t count, float w, float h);
+
 	// An image displayed on the screen at a location.
 	class VisualComponent {
 		std::string imagePath;
@@ -0,0 +1,44 @@
+#include "Game.h"
+#include <chrono>
+
+Rect getRect(int gridSizeX, int gridSizeY, int gridIndX, int gridIndY, float scale) {
+    Rect retRect;
+    retRect.w = 2.0f / gridSizeX;
+    retRect.h = 2.0f / gridSizeY;
+    retRect.x = -1.0f + gridIndX * retRect.w;
+    retRect.y = 1.0f - gridIndY * retRect.h;
+    retRect.x += retRect.w * (1 - scale) / 2;
+    retRect.y -= retRect.h * (1 - scale) / 2;
+    retRect.w *= scale;
+    retRect.h *= scale;
+    return retRect;
+}
+
+Rect getRect(int gridSizeX, int gridSizeY, int gridIndX, int gridIndY, float scale, Rect gridRect) {
+    Rect retRect;
+    retRect.w = gridRect.w / gridSizeX;
+    retRect.h = gridRect.h / gridSizeY;
+    retRect.x = gridRect.x + gridIndX * retRect.w;
+    retRect.y = gridRect.y - gridIndY * retRect.h;
+    retRect.x += retRect.w * (1 - scale) / 2;
+    retRect.y -= retRect.h * (1 - scale) / 2;
+    retRect.w *= scale;
+    retRect.h *= scale;
+    return retRect;
+}
+
+double playReplay(const Replay& replay) {
+    if (replay.level != BreakoutGame::levelId)
+        throw "Replay is of a level this game doesn't have";
+    BreakoutGame game{ replay.seed };
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    for (uint32_t tick = 0; tick < replay.tickCount; ++tick) {
+        // Inputs come between ticks, so each one goes before the tick after it
+        for (; next < replay.events.size() && replay.events[next].tick == tick; ++next)
+            game.input(replay.events[next].input);
+        game.tick();
+    }
+    std::chrono::duration<double> taken = std::chrono::steady_clock::now() - start;
+    return replay.tickCount / taken.count();
+}
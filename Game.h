@@ -0,0 +1,490 @@
+#pragma once
+#include "DisplaySystem.h"
+#include "LineAndCircleBoundedCollidable.h"
+#include "ParticleSystem.h"
+#include "Replay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <optional>
+#include <random>
+
+// Represents the top left corner of a rectangle, and its width and height
+struct Rect {
+	float x;
+	float y;
+	float w;
+	float h;
+};
+
+// Creates a Rect using screen coordinates based on a location within a grid
+// gridSizeX: Number of grid cells in the x direction
+// gridSizeY: Number of grid cells in the y direction
+// gridIndX: The x index of the cell in the grid to put the rectangle in
+// gridIndY: The y index of the cell in the grid to put the rectangle in
+// scale: A factor to scale the sidelengths of the rectangle by
+Rect getRect(int gridSizeX, int gridSizeY, int gridIndX, int gridIndY, float scale);
+
+// Creates a Rect using screen coordinates based on a location within a grid, and a rectangle that contains the grid
+// gridSizeX: Number of grid cells in the x direction
+// gridSizeY: Number of grid cells in the y direction
+// gridIndX: The x index of the cell in the grid to put the rectangle in
+// gridIndY: The y index of the cell in the grid to put the rectangle in
+// scale: A factor to scale the sidelengths of the rectangle by
+// gridRect: A Rect that the grid is inside of
+Rect getRect(int gridSizeX, int gridSizeY, int gridIndX, int gridIndY, float scale, Rect gridRect);
+
+// An object with a circle for a hitbox
+class CircleObject : private LineAndCircleBoundedCollidable {
+	float radius;
+
+	CircleObject& operator=(CircleObject&&) = delete;
+	CircleObject(const CircleObject&) = delete;
+	CircleObject& operator=(const CircleObject&) = delete;
+public:
+	using LineAndCircleBoundedCollidable::getLocation;
+	using LineAndCircleBoundedCollidable::getVelocity;
+	using LineAndCircleBoundedCollidable::changeTrajectory;
+	using LineAndCircleBoundedCollidable::changeVelocity;
+
+	CircleObject(CollisionWorld& world, float2 location, float2 velocity, float initRadius, float /*mass*/)
+		: LineAndCircleBoundedCollidable{ world, location, velocity }, radius{ initRadius } {
+		
+		addCircle({ 0.0f,0.0f }, radius);
+	}
+
+	CircleObject(CircleObject&& other) noexcept : LineAndCircleBoundedCollidable{ std::move(other) }, radius{ other.radius } {}
+};
+
+// The blocks which can be destroyed by the ball. The whole grid of blocks is one object, so breaking a block only empties a cell
+class BrickField : private LineAndCircleBoundedCollidable {
+	std::vector<std::optional<DisplaySystem::VisualComponent>> images; // Empty for broken blocks
+	Rect area;
+	unsigned int columns;
+	unsigned int rows;
+	float scale;
+	unsigned char initHealth;
+	unsigned int blocksLeft;
+	ParticleSystem& fragments;
+	std::minstd_rand random;
+	static constexpr int fragmentsPerBlock = 40;
+
+	BrickField(BrickField&&) = delete;
+	BrickField& operator=(BrickField&&) = delete;
+	BrickField(const BrickField&) = delete;
+	BrickField& operator=(const BrickField&) = delete;
+
+	virtual const Matrix2x2 getInverseMassMatrix() {
+		return { 0,0,0,0 };
+	}
+
+	virtual void onCellCollision(unsigned int column, unsigned int row) {
+		unsigned char health = getCell(column, row);
+		if (!health)
+			return;
+		setCell(column, row, health - 1);
+		// A block broken again after a rollback has already been shown breaking, and counted
+		auto& image = images[row * columns + column];
+		if (health == 1 && image) {
+			image.reset();
+			--blocksLeft;
+			breakIntoFragments(getRect(columns, rows, column, row, scale, area));
+		}
+	}
+
+	void showBlock(unsigned int column, unsigned int row) {
+		auto& image = images[row * columns + column];
+		if (!image) {
+			Rect rect = getRect(columns, rows, column, row, scale, area);
+			image.emplace("images/Block.png", rect.x, rect.y, rect.w, rect.h);
+		}
+	}
+
+	// Scatters fragments from a broken block, which fall and bounce off the walls and bat
+	void breakIntoFragments(Rect rect) {
+		std::uniform_real_distribution<float> across{ 0.0f,1.0f };
+		std::uniform_real_distribution<float> speed{ -0.01f,0.01f };
+		std::uniform_real_distribution<float> life{ 60.0f,180.0f };
+		for (int i = 0; i < fragmentsPerBlock; ++i) {
+			float2 location = { rect.x + rect.w * across(random),rect.y - rect.h * across(random) };
+			fragments.spawn(location, { speed(random),speed(random) }, life(random));
+		}
+	}
+public:
+	// Fills 'area' with a grid of blocks, each scaled by 'scale' within its cell. Broken blocks leave fragments in 'fragments', scattered
+	// randomly from 'seed'
+	BrickField(CollisionWorld& world, Rect area, unsigned int columns, unsigned int rows, float scale, unsigned char initHealth, ParticleSystem& fragments,
+		uint32_t seed)
+		: LineAndCircleBoundedCollidable{ world, { area.x,area.y },{ 0.0f,0.0f } }, area{ area }, columns{ columns }, rows{ rows },
+		scale{ scale }, initHealth{ initHealth }, blocksLeft{ 0 }, fragments{ fragments }, random{ seed } {
+		makeTileGrid({ 0.0f,0.0f }, { area.w / columns,area.h / rows }, columns, rows, scale);
+		images.resize(columns * rows);
+		refill();
+	}
+
+	// Puts back every block
+	void refill() {
+		for (unsigned int row = 0; row < rows; ++row) {
+			for (unsigned int column = 0; column < columns; ++column) {
+				setCell(column, row, initHealth);
+				showBlock(column, row);
+			}
+		}
+		blocksLeft = columns * rows;
+	}
+
+	// Brings the count of blocks and their images back in step with the tile grid's cells, which are all the world keeps of the blocks.
+	// For after the world has been rolled back and its ticks done again, rather than straight after the rollback, so that blocks broken
+	// in both goes aren't shown breaking twice. Fragments of blocks that are back are left to fall
+	void matchCells() {
+		blocksLeft = 0;
+		for (unsigned int row = 0; row < rows; ++row) {
+			for (unsigned int column = 0; column < columns; ++column) {
+				if (getCell(column, row)) {
+					++blocksLeft;
+					showBlock(column, row);
+				}
+				else
+					images[row * columns + column].reset();
+			}
+		}
+	}
+
+	bool empty() {
+		return blocksLeft == 0;
+	}
+};
+
+// The walls around the level, which do not move and which nothing can pass through. They are all one object, with its lines baked
+// so that the balls only check the few lines near them
+class Walls : private LineAndCircleBoundedCollidable {
+	std::vector<DisplaySystem::VisualComponent> images;
+
+	Walls(Walls&&) = delete;
+	Walls& operator=(Walls&&) = delete;
+	Walls(const Walls&) = delete;
+	Walls& operator=(const Walls&) = delete;
+
+	virtual const Matrix2x2 getInverseMassMatrix() {
+		return { 0,0,0,0 };
+	}
+public:
+	Walls(CollisionWorld& world) : LineAndCircleBoundedCollidable{ world, { 0.0f,0.0f },{ 0.0f,0.0f } } {}
+
+	void add(Rect rect) {
+		images.emplace_back("images/Wall.bmp", rect.x, rect.y, rect.w, rect.h);
+		addLine({ rect.x,rect.y }, { rect.x + rect.w,rect.y });
+		addLine({ rect.x + rect.w,rect.y }, { rect.x + rect.w,rect.y - rect.h });
+		addLine({ rect.x + rect.w,rect.y - rect.h }, { rect.x,rect.y - rect.h });
+		addLine({ rect.x,rect.y - rect.h }, { rect.x,rect.y });
+	}
+
+	// Should be called once every wall has been added
+	void bake() {
+		bakeStaticMesh();
+	}
+};
+
+// How the ball moves and bounces, with nothing to do with drawing it, so that it can also be used where there is no display
+class BallPhysics : private CircleObject {
+	float radius;
+	float mass;
+
+	BallPhysics& operator=(BallPhysics&&) = delete;
+	BallPhysics(const BallPhysics&) = delete;
+	BallPhysics& operator=(const BallPhysics&) = delete;
+
+	// Does not contribute to friction during collisions
+	virtual float getCorFactorPerp() {
+		return 1.0f;
+	}
+
+	virtual const Matrix2x2 getInverseMassMatrix() {
+		return { 1 / mass, 0, 0, 1 / mass };
+	}
+public:
+	using CircleObject::getLocation;
+	using CircleObject::getVelocity;
+	using CircleObject::changeTrajectory;
+	using CircleObject::changeVelocity;
+
+	BallPhysics(CollisionWorld& world, float2 location, float2 velocity, float initRadius, float initMass)
+		: CircleObject{ world,location,velocity,initRadius,initMass }, radius{ initRadius }, mass{ initMass } {}
+
+	BallPhysics(BallPhysics&& other) noexcept : CircleObject{ std::move(other) }, radius{ other.radius }, mass{ other.mass } {}
+
+	float getRadius() const {
+		return radius;
+	}
+
+	bool isOffScreen() {
+		float2 loc = getLocation();
+		return std::fmax(std::abs(loc.x), std::abs(loc.y)) > 1.0f + radius;
+	}
+};
+
+// The ball that the player hits
+class Ball : private BallPhysics {
+	DisplaySystem::VisualComponent image;
+
+	Ball& operator=(Ball&&) = delete;
+	Ball(const Ball&) = delete;
+	Ball& operator=(const Ball&) = delete;
+public:
+	Ball(CollisionWorld& world, float2 location, float2 velocity, float initRadius, float initMass)
+		: BallPhysics{ world,location,velocity,initRadius,initMass },
+		image{ "images/Ball.png",location.x - initRadius,location.y + initRadius,2 * initRadius,2 * initRadius } {}
+
+	using BallPhysics::isOffScreen;
+
+	bool tick() {
+		float2 loc = getLocation();
+		image.changeLocation(loc.x - getRadius(), loc.y + getRadius());
+		return isOffScreen();
+	}
+
+	Ball(Ball&& other) noexcept : BallPhysics{ std::move(other) }, image{ std::move(other.image) } {}
+};
+
+// How the bat moves and what it does in collisions, with nothing to do with drawing it, so that it can also be used where there is
+// no display
+class BatPhysics : private LineAndCircleBoundedCollidable {
+	float width;
+	float height;
+	static constexpr float mass = 1.0f;
+
+	BatPhysics(BatPhysics&&) = delete;
+	BatPhysics& operator=(BatPhysics&&) = delete;
+	BatPhysics(const BatPhysics&) = delete;
+	BatPhysics& operator=(const BatPhysics&) = delete;
+
+	virtual float getCorFactorPerp() {
+		return 1.0f;
+	}
+
+	// Tangential friction allows for the ball to be dragged by the bat
+	virtual float getCorFactorTang() {
+		return 0.5f;
+	}
+
+	// Will not be moved vertically in collisions, but can be accelerated horizontally to avoid
+	// passing through walls or freezing the game when sqeezing a ball against a wall
+	virtual const Matrix2x2 getInverseMassMatrix() {
+		return { 1 / mass, 0, 0, 0 };
+	}
+
+	// Will not recoil on collisions, but instead stay still
+	virtual void onCollision() {
+		if (getVelocity() != float2{ 0.0f, 0.0f })
+			changeVelocity({ 0.0f, 0.0f });
+	}
+public:
+	static constexpr float speed = 0.03f;
+
+	using LineAndCircleBoundedCollidable::getLocation;
+	using LineAndCircleBoundedCollidable::getVelocity;
+	using LineAndCircleBoundedCollidable::changeTrajectory;
+
+	BatPhysics(CollisionWorld& world, Rect rect) : LineAndCircleBoundedCollidable{ world, {rect.x, rect.y}, {0.0f, 0.0f} },
+		width{ rect.w }, height{ rect.h }
+	{
+		// Sets the hitbox of the bat
+		addCircle({ rect.h / 2, -rect.h / 2 }, rect.h / 2);
+		addCircle({ rect.w - rect.h / 2, -rect.h / 2 }, rect.h / 2);
+		addLine({ rect.h / 2,0.0f }, { rect.w - rect.h / 2,0.0f });
+		addLine({ rect.w - rect.h / 2, -rect.h }, { rect.h / 2, -rect.h });
+	}
+
+	float getWidth() const {
+		return width;
+	}
+
+	float getHeight() const {
+		return height;
+	}
+
+	// Moves left at the bat's speed for a direction of -1, right for 1, or stops for 0
+	void steer(int direction) {
+		float2 velocity = { direction * speed,0.0f };
+		if (getVelocity() != velocity)
+			changeVelocity(velocity);
+	}
+
+	// Lets particles bounce off the bat where it is now
+	void addTo(ParticleSystem& particles) {
+		float2 loc = getLocation();
+		particles.addCapsule({ loc.x + height / 2.0f,loc.y - height / 2.0f }, { loc.x + width - height / 2.0f,loc.y - height / 2.0f }, height / 2.0f,
+			getVelocity());
+	}
+};
+
+// The bat that the player moves
+class Bat : private BatPhysics {
+	DisplaySystem::VisualComponent leftBat;
+	DisplaySystem::VisualComponent centreBat;
+	DisplaySystem::VisualComponent rightBat;
+	bool movingLeft;
+	bool movingRight;
+public:
+	Bat(CollisionWorld& world, Rect rect) : BatPhysics{ world, rect },
+		leftBat{ "images/LeftBat.png", rect.x, rect.y, rect.h / 2.0f, rect.h },
+		centreBat{ "images/BatCentre.png", rect.x + rect.h / 2.0f, rect.y, rect.w - rect.h, rect.h },
+		rightBat{ "images/RightBat.png", rect.x + rect.w - rect.h / 2.0f, rect.y, rect.h / 2.0f, rect.h },
+		movingLeft{ false }, movingRight{ false } {}
+
+	using BatPhysics::addTo;
+
+	void tick() {
+		// Sets the velocity of the bat
+		steer(movingLeft == movingRight ? 0 : movingLeft ? -1 : 1);
+		movingLeft = false;
+		movingRight = false;
+
+		// Updates the location of the images
+		float2 loc = getLocation();
+		leftBat.changeLocation(loc.x, loc.y);
+		centreBat.changeLocation(loc.x + getHeight() / 2.0f, loc.y);
+		rightBat.changeLocation(loc.x + getWidth() - getHeight() / 2.0f, loc.y);
+	}
+	void moveLeft() {
+		movingLeft = true;
+	}
+	void moveRight() {
+		movingRight = true;
+	}
+};
+
+// Manages the logic of the game
+class BreakoutGame {
+	CollisionWorld world; // First, so that it is destroyed after everything in it
+	ParticleSystem fragments;
+	Walls walls;
+	BrickField bricks;
+	std::list<Ball> balls;
+	Bat bat;
+	bool leftDown;
+	bool rightDown;
+	bool leftUp;
+	bool rightUp;
+	Replay replay; // Everything needed to play this game again
+
+	void record(GameInput input) {
+		replay.events.push_back(ReplayEvent{ replay.tickCount,input });
+	}
+public:
+	static constexpr float fragmentSize = 0.008f;
+	static constexpr uint32_t levelId = 0; // There is only one level so far
+
+	// Random numbers are only used for how things look, but come from 'seed' so that replays look the same too
+	explicit BreakoutGame(uint32_t seed)
+		: fragments{ { 0.0f,-0.0005f }, 0.5f, 4 }, walls{ world },
+		bricks{ world, Rect{ -0.9f, 0.72f, 1.8f, 0.72f }, 10, 8, 0.9f, 1, fragments, seed }, // Blocks fill rows 2 to 9 of a 10 by 20 grid
+		bat{ world, Rect{ -0.1f, -0.84f, 0.2f, 0.05f } }, replay{ seed, levelId, 0, {} } {
+		// Adds one ball
+		balls.emplace_back(world, float2{ 0.0f,-0.5f }, float2{ -0.01f,-0.01f }, 0.025f, 1.0f);
+
+		// Adds bounding walls
+		Rect temp = getRect(20, 1, 0, 0, 1.0f);
+		for (Rect rect : { getRect(20, 1, 0, 0, 1.0f), getRect(20, 1, 19, 0, 1.0f), getRect(1, 20, 0, 0, 1.0f, { temp.x + temp.w,1.0f ,2.0f * 18.0f / 20.0f,2.0f }) }) {
+			walls.add(rect);
+			fragments.addBox({ rect.x,rect.y - rect.h }, { rect.x + rect.w,rect.y });
+		}
+		walls.bake();
+		world.sortStorageSpatially(); // Only here, as it gives every object a new handle
+
+		leftDown = false;
+		rightDown = false;
+		leftUp = false;
+		rightUp = false;
+	}
+	void tick() {
+		++replay.tickCount; // First, so that a tick that throws is in the replay
+		if (leftDown)
+			bat.moveLeft();
+		if (rightDown)
+			bat.moveRight();
+
+		// Call tick() functions; remove balls which are offscreen
+		for (auto it = balls.begin(); it != balls.end();) {
+			if (it->tick()) {
+				it = balls.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		bat.tick();
+
+		// If no blocks or no balls, reset game
+		if (bricks.empty() || balls.empty()) {
+			balls.clear();
+
+			bricks.refill();
+			balls.emplace_back(world, float2{ 0.0f,-0.5f }, float2{ -0.01f,-0.01f }, 0.025f, 1.0f);
+		}
+
+		// Move the fragments of broken blocks
+		fragments.clearCapsules();
+		bat.addTo(fragments);
+		fragments.tick();
+		DisplaySystem::showMany("images/Block.png", fragments.getX(), fragments.getY(), fragments.size(), fragmentSize, fragmentSize);
+
+		// Update screen
+		DisplaySystem::update();
+
+		// Do collisions
+		world.doTickOfCollisions();
+
+		// Reset key states
+		if (leftUp)
+			leftDown = false;
+		if (rightUp)
+			rightDown = false;
+		leftUp = false;
+		rightUp = false;
+	}
+	void leftPress() {
+		record(GameInput::leftPress);
+		leftDown = true;
+	}
+	void rightPress() {
+		record(GameInput::rightPress);
+		rightDown = true;
+	}
+	void leftReleased() {
+		record(GameInput::leftRelease);
+		leftUp = true;
+	}
+	void rightReleased() {
+		record(GameInput::rightRelease);
+		rightUp = true;
+	}
+	void input(GameInput input) {
+		switch (input) {
+		case GameInput::leftPress:
+			leftPress();
+			break;
+		case GameInput::rightPress:
+			rightPress();
+			break;
+		case GameInput::leftRelease:
+			leftReleased();
+			break;
+		case GameInput::rightRelease:
+			rightReleased();
+			break;
+		}
+	}
+	const Replay& getReplay() const {
+		return replay;
+	}
+	// For checking that two games are in the same state, e.g. by comparing snapshots
+	const CollisionWorld& getWorld() const {
+		return world;
+	}
+};
+
+// Plays a recorded game again, through the same tick() as when it was played but as fast as it will go. Returns the ticks done per second
+double playReplay(const Replay& replay);
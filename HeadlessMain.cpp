@@ -0,0 +1,97 @@
+#include "Game.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <string>
+
+// Runs the game with no window and as fast as it will go, for measuring performance and checking replays on machines without a display.
+// Built with NullDisplaySystem.cpp in place of DisplaySystem.cpp
+//   -ticks N     How many ticks to run the scripted game for (default 100000)
+//   -seed S      Seed for the game and for the scripted inputs (default 1)
+//   -record F    Saves the scripted game as a replay to F
+//   -replay F    Plays the replay in F instead of a scripted game
+
+// Presses and releases left and right at random, holding each for a random number of ticks, like a player that isn't paying attention.
+// The same seed gives the same inputs, so that runs can be compared
+static double playScripted(BreakoutGame& game, uint32_t seed, uint32_t ticks) {
+    std::minstd_rand random{ seed };
+    std::uniform_int_distribution<uint32_t> holdTicks{ 5,60 };
+    std::uniform_int_distribution<int> choice{ 0,2 }; // Left, right or neither
+    uint32_t nextChange = 0;
+    int held = 2;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t tick = 0; tick < ticks; ++tick) {
+        if (tick == nextChange) {
+            int next = choice(random);
+            if (next != held) {
+                if (held == 0)
+                    game.input(GameInput::leftRelease);
+                else if (held == 1)
+                    game.input(GameInput::rightRelease);
+                if (next == 0)
+                    game.input(GameInput::leftPress);
+                else if (next == 1)
+                    game.input(GameInput::rightPress);
+                held = next;
+            }
+            nextChange = tick + holdTicks(random);
+        }
+        game.tick();
+    }
+    std::chrono::duration<double> taken = std::chrono::steady_clock::now() - start;
+    return ticks / taken.count();
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t ticks = 100000;
+    uint32_t seed = 1;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "-ticks") == 0)
+            ticks = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (i + 1 < argc && std::strcmp(argv[i], "-seed") == 0)
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (i + 1 < argc && std::strcmp(argv[i], "-record") == 0)
+            recordPath = argv[++i];
+        else if (i + 1 < argc && std::strcmp(argv[i], "-replay") == 0)
+            replayPath = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: %s [-ticks N] [-seed S] [-record file] [-replay file]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    try {
+        double ticksPerSecond;
+        if (replayPath) {
+            Replay replay = Replay::load(replayPath);
+            ticks = replay.tickCount;
+            ticksPerSecond = playReplay(replay);
+        }
+        else {
+            BreakoutGame game{ seed };
+            ticksPerSecond = playScripted(game, seed, ticks);
+            if (recordPath)
+                game.getReplay().save(recordPath);
+        }
+        std::printf("%u ticks in %.3f s: %.0f ticks/s\n", ticks, ticks / ticksPerSecond, ticksPerSecond);
+    }
+    catch (const char* message) {
+        std::fprintf(stderr, "%s\n", message);
+        return 1;
+    }
+    catch (const std::string& message) {
+        std::fprintf(stderr, "%s\n", message.c_str());
+        return 1;
+    }
+    catch (const std::exception& exception) {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+    DisplaySystem::cleanup();
+    return 0;
+}
@@ -1,265 +1,902 @@
 #include "LineAndCircleBoundedCollidable.h"
+#include "NarrowPhase.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 
-std::set<LineAndCircleBoundedCollidable*, LineAndCircleBoundedCollidable::comparisonFunction> LineAndCircleBoundedCollidable::collidables{};
+// A collision is a repeat of the last one if it happens within this time of it...
+constexpr float repeatedCollisionTime = 1e-3f;
+// ...and the object has moved less than this distance since it (zero separation, give or take rounding)
+constexpr float repeatedCollisionDistance = 1e-5f;
+// Number of repeated collisions in a row before an object is treated as resting against what it hits
+constexpr unsigned int restingContactThreshold = 2;
+// Collisions within this time of each other involving the same object are resolved together
+constexpr float simultaneousCollisionTime = 1e-4f;
+// Number of times contacts resolved together are corrected for each other
+constexpr int contactSolverPasses = 4;
+// Handles are the generation of a slot in the top bits and its index in the rest
+constexpr uint32_t slotIndexBits = 20;
+constexpr uint32_t slotIndexMask = (1u << slotIndexBits) - 1;
+constexpr uint32_t maxGeneration = (1u << (32 - slotIndexBits)) - 1;
+// Body::tileGrid of objects that aren't tile grids
+constexpr uint32_t noTileGrid = UINT32_MAX;
+// Body::staticMesh of objects that haven't been baked
+constexpr uint32_t noStaticMesh = UINT32_MAX;
+// SpatialGrid::bodyCell of objects that aren't in a cell, and the end of each cell's objects
+constexpr uint32_t noCell = UINT32_MAX;
+constexpr uint32_t noBody = UINT32_MAX;
+// Most shapes in a leaf of a baked mesh's tree
+constexpr uint32_t meshLeafSize = 4;
+// Boxes are widened by this much when searching a baked mesh, so that shapes just touching aren't missed because of rounding
+constexpr float meshBoxMargin = 1e-5f;
+// Collision times are worked out again in double if float decided something on a difference smaller than this fraction of the sizes
+// involved, e.g. whether a ball only just grazes a corner
+constexpr float closeCallTolerance = 1e-5f;
+// Longest jump made at once by advanceUntil. Times in the world are floats from the start of the jump, so they lose precision if it is
+// much longer
+constexpr float maxAdvanceSpan = 64.0f;
+// Start of every snapshot, then the version of the format, which changes whenever what is saved does
+constexpr uint32_t snapshotMagic = 0x53574342; // "BCWS" read as little-endian bytes
+constexpr uint32_t snapshotVersion = 3;
+// Collision times that have been worked out again in double. Counted for each thread, as the narrow phase doesn't know which world it
+// is working for, and each world adds on what was counted during its tick
+static thread_local unsigned long long precisionFallbacks = 0;
 
-bool operator==(const float2& a, const float2& b) {
-    return (a.x == b.x) && (a.y == b.y);
+template <typename Scalar>
+struct LineOf {
+    Vector2<Scalar> p1;
+    Vector2<Scalar> p2;
+};
+template <typename Scalar>
+LineOf<Scalar> operator+(const LineOf<Scalar>& line, const Vector2<Scalar>& offset) {
+    return { line.p1 + offset,line.p2 + offset };
 }
-
-bool operator!=(const float2& a, const float2& b) {
-    return !((a.x == b.x) && (a.y == b.y));
+template <typename Scalar>
+LineOf<Scalar> operator-(const LineOf<Scalar>& line, const Vector2<Scalar>& offset) {
+    return { line.p1 - offset,line.p2 - offset };
 }
 
-float2 operator*(const float2& x, float a) {
-    return { a * x.x,a * x.y };
+template <typename Scalar>
+struct CircleOf {
+    Vector2<Scalar> centre;
+    Scalar radius;
+};
+template <typename Scalar>
+CircleOf<Scalar> operator+(const CircleOf<Scalar>& circle, const Vector2<Scalar>& offset) {
+    return { circle.centre + offset,circle.radius };
 }
-
-float2 operator*(float a, const float2& x) {
-    return { a * x.x,a * x.y };
+template <typename Scalar>
+CircleOf<Scalar> operator-(const CircleOf<Scalar>& circle, const Vector2<Scalar>& offset) {
+    return { circle.centre - offset,circle.radius };
 }
 
-float2 operator/(const float2& x, float a) {
-    return { x.x / a,x.y / a };
+static Vector2<double> toDouble(const float2& x) {
+    return { x.x,x.y };
 }
-
-float2 operator+(const float2& a, const float2& b) {
-    return { a.x + b.x,a.y + b.y };
+static LineOf<double> toDouble(const Line& line) {
+    return { toDouble(line.p1),toDouble(line.p2) };
 }
-
-float2 operator-(const float2& a, const float2& b) {
-    return { a.x - b.x,a.y - b.y };
+static CircleOf<double> toDouble(const Circle& circle) {
+    return { toDouble(circle.centre),circle.radius };
 }
 
-float2& operator+=(float2& a, const float2& b) {
-    a.x = a.x + b.x;
-    a.y = a.y + b.y;
-    return a;
-}
+CollisionWorld::CollisionWorld()
+    : heap{}, pool{ &heap }, queueNodePool{ &heap }, bodies{ &heap }, freeSlots{ &heap }, collidables{ comparisonFunction{ this },&queueNodePool },
+    statistics{}, elapsed{ 0.0 }, maxEventsPerTick{ 10000 }, neighbourSkin{ 0.15f }, lineStore{ &pool }, circleStore{ &pool }, unusedShapes{ 0 },
+    tileGrids{ &pool }, freeTileGrids{ &pool }, staticMeshes{ &pool }, freeStaticMeshes{ &pool }, recordingCollisionEvents{ false },
+    collisionEvents{ &heap }, spatialGrid{ &pool }, contacts{ &heap }, participants{ &heap }, collided{ &heap }, toCheck{ &heap },
+    cellsHit{ &heap }, heldBack{ &heap }, candidates{ &heap }, nearlySoonest{ &heap }, neighbourCandidates{ &heap },
+    nearestCandidates{ &heap }, shapeBoxes{ &heap } {}
 
-float2& operator-=(float2& a, const float2& b) {
-    a.x = a.x - b.x;
-    a.y = a.y - b.y;
-    return a;
-}
+CollisionWorld::~CollisionWorld() = default;
 
-float2 operator-(const float2& a) {
-    return { -a.x,-a.y };
-}
+CollisionWorld::Body::Body(CollisionWorld* world)
+    : world{ world }, scheduledVelocities{ &world->pool }, simultaneousCollisions{ &world->pool }, neighbours{ &world->pool } {}
 
-float dotProduct(const float2& a, const float2& b) {
-    return a.x * b.x + a.y * b.y;
-}
+CollisionWorld::TileGrid::TileGrid(std::pmr::memory_resource* memory) : cells{ memory } {}
 
-float2 operator*(const Matrix2x2& a, const float2& x) {
-    return { a.xx * x.x + a.xy * x.y,a.yx * x.x + a.yy * x.y };
-}
+CollisionWorld::StaticMesh::StaticMesh(std::pmr::memory_resource* memory) : nodes{ memory }, shapes{ memory } {}
 
-Matrix2x2 operator+(const Matrix2x2& a, const Matrix2x2& b) {
-    return { a.xx + b.xx,a.xy + b.xy,a.yx + b.yx,a.yy + b.yy };
-}
+CollisionWorld::SpatialGrid::SpatialGrid(std::pmr::memory_resource* memory)
+    : low{ 0.0f,0.0f }, cellSize{ 0.0f }, columns{ 0 }, rows{ 0 }, largeRadius{ 0.0f }, reach{ 0.0f }, fastestSpeed{ 0.0f }, cellFirst{ memory }, bodyCell{ memory },
+    bodyNext{ memory }, largeBodies{ memory }, radii{ memory }, valid{ false } {}
 
-struct Line {
-    float2 p1;
-    float2 p2;
-};
-Line operator+(const Line& line, const float2& offset) {
-    return { line.p1 + offset,line.p2 + offset };
-}
-Line operator-(const Line& line, const float2& offset) {
-    return { line.p1 - offset,line.p2 - offset };
+void CollisionWorld::doTickOfCollisions(){
+    advance(1.0f, false);
+    elapsed += 1.0;
 }
 
-struct Circle {
-    float2 centre;
-    float radius;
-};
-Circle operator+(const Circle& circle, const float2& offset) {
-    return { circle.centre + offset,circle.radius };
-}
-Circle operator-(const Circle& circle, const float2& offset) {
-    return { circle.centre - offset,circle.radius };
+double CollisionWorld::advanceUntil(double time, bool stopAtCollision) {
+    while (elapsed < time) {
+        double remaining = time - elapsed;
+        float duration = static_cast<float>(std::min(remaining, static_cast<double>(maxAdvanceSpan)));
+        float reached = advance(duration, stopAtCollision);
+        if (reached < duration) { // Stopped at a collision
+            elapsed += reached;
+            break;
+        }
+        elapsed = remaining <= maxAdvanceSpan ? time : elapsed + duration; // Not left short of 'time' by rounding
+    }
+    return elapsed;
 }
 
-void LineAndCircleBoundedCollidable::doTickOfCollisions(){
+// Does the collisions up to 'duration' ticks on, then moves everything there, with times counted from there afterwards. Returns the
+// time it got to, which is sooner than duration if it stopped at a collision
+float CollisionWorld::advance(float duration, bool stopAtCollision) {
+    collisionEvents.clear();
     if (collidables.empty()) {
-        return; // Need to ensure front() exists, also nothing to do if empty
+        return duration; // Need to ensure front() exists, also nothing to do if empty
     }
 
-    while ((*(collidables.begin()))->timeOfCollision < 1) {
-        LineAndCircleBoundedCollidable& first = **(collidables.begin());
-        if (!first.nextPossibleCollision) { // No collision
+    statistics.eventsLastTick = 0;
+    // The event budget is for each tick gone through, counted from the start of the advance
+    unsigned int eventsThisTick = 0;
+    float tickEnd = 1.0f;
+    float end = duration;
+    unsigned long long heapAllocationsBefore = heap.getAllocations();
+    unsigned long long precisionFallbacksBefore = precisionFallbacks;
+    while (!collidables.empty() && bodies[*collidables.begin()].timeOfCollision < duration) { // onCollision could destroy everything
+        Body& first = bodies[*collidables.begin()];
+        if (!first.nextPossibleCollision) { // No collision, but needs checking again
+            if (first.timeOfCollision > first.timeAhead) {
+                first.location += first.velocity * (first.timeOfCollision - first.timeAhead);
+                first.timeAhead = first.timeOfCollision;
+            }
+            if (!first.scheduledVelocities.empty() && first.scheduledVelocities.front().time <= first.timeOfCollision) {
+                first.applyScheduledVelocity();
+            }
             first.checkForNextCollision();
             continue;
         }
-        LineAndCircleBoundedCollidable& other = *(first.nextPossibleCollision);
+        Body& other = *getBody(first.nextPossibleCollision);
+        float time = first.timeOfCollision;
 
-        // Step to collision
-        if (first.timeOfCollision > first.timeAhead) { // Stop slightly short to avoid problems with rounding and intersecting slightly
-            first.location += first.velocity * (first.timeOfCollision - first.timeAhead);
+        if (time >= tickEnd) {
+            eventsThisTick = 0;
+            tickEnd = std::floor(time) + 1;
         }
-        if (other.timeOfCollision > other.timeAhead) {
-            other.location += other.velocity * (other.timeOfCollision - other.timeAhead);
+        if (eventsThisTick >= maxEventsPerTick) {
+            holdBackRemainingEvents(std::min(tickEnd, duration));
+            continue; // Ends the loop unless there are ticks after this one
         }
-        first.timeAhead = first.timeOfCollision;
-        other.timeAhead = other.timeOfCollision; // should be the same timeOfCollision
+        ++eventsThisTick;
+        ++statistics.eventsLastTick;
+        ++statistics.totalEvents;
 
-        float2& forceVec = first.forceVec;
+        // Anything else hitting first or other at (almost) the same time, e.g. a ball hitting the corner between two blocks,
+        // is resolved in the same step rather than as a series of collisions each needing the objects to be checked again
+        contacts.clear();
+        contacts.push_back(Contact{ &first,&other,first.forceVec,first.contactCell });
+        first.gatherSimultaneousContacts(time, contacts);
+        other.gatherSimultaneousContacts(time, contacts);
+        statistics.batchedContacts += contacts.size() - 1;
+
+        participants.clear();
+        for (auto& contact : contacts) {
+            for (auto ptr : { contact.a,contact.b }) {
+                if (std::find(participants.begin(), participants.end(), ptr) == participants.end())
+                    participants.push_back(ptr);
+            }
+        }
+
+        // Step to collision
+        for (auto ptr : participants) {
+            if (time > ptr->timeAhead) { // Stop slightly short to avoid problems with rounding and intersecting slightly
+                ptr->location += ptr->velocity * (time - ptr->timeAhead);
+            }
+            ptr->timeAhead = time;
+        }
 
-        if (dotProduct(forceVec, forceVec) == 0) { // If forceVec is zero vector
+        if (dotProduct(first.forceVec, first.forceVec) == 0) { // If forceVec is zero vector
             //forceVec = other.location - first.location; // Use an arbitrary direction. Will be buggy if this happens, but better than a crash
             throw "Force has no direction";
         }
 
-        // Perpendicular part of bounce
-        float X = -2 * dotProduct(first.velocity - other.velocity, forceVec)
-            / dotProduct(forceVec, (first.getInverseMassMatrix() + other.getInverseMassMatrix()) * forceVec);
-        X *= (1 + first.getCorFactorPerp()) / 2;
-        X *= (1 + other.getCorFactorPerp()) / 2;
+        // Objects hitting each other again and again at the same time (e.g. a ball squeezed between the bat and a wall) would never
+        // get to the end of the tick, so they are treated as resting against each other and stop moving together instead of bouncing
+        for (auto ptr : participants)
+            ptr->countRepeatedCollision(time);
+        for (auto& contact : contacts)
+            contact.resting = contact.a->repeatedCollisions >= restingContactThreshold || contact.b->repeatedCollisions >= restingContactThreshold;
 
-        if (!isnormal(X)) { // Check X was calculated fine
-            //X = 0.0f; // This case is a problem
-            throw "Cannot calculate new trajectories, X = " + std::to_string(X);
-        }
+        resolveContacts(contacts);
 
-        first.velocity += first.getInverseMassMatrix() * (X * forceVec);
-        other.velocity -= other.getInverseMassMatrix() * (X * forceVec);
+        if (recordingCollisionEvents) {
+            for (auto& contact : contacts) {
+                float length = std::sqrt(dotProduct(contact.forceVec, contact.forceVec));
+                collisionEvents.push_back(CollisionEvent{ time,contact.a->getHandle(),contact.b->getHandle(),contact.forceVec / length,
+                    contact.impulse * length,contact.cell });
+            }
+        }
 
-        // Tangential part of bounce
-        float2 velocityInPlane1 = first.velocity - forceVec * dotProduct(first.velocity, forceVec) / dotProduct(forceVec, forceVec);
-        float2 velocityInPlane2 = other.velocity - forceVec * dotProduct(other.velocity, forceVec) / dotProduct(forceVec, forceVec);
-        float2 velDif = velocityInPlane2 - velocityInPlane1; // Direction of force
-        float2 sampleVelChange1 = first.getInverseMassMatrix() * velDif;
-        float2 sampleVelChange2 = -(other.getInverseMassMatrix() * velDif);
-        // For CoR = 0:
-        // velocityInPlane1 + x * sampleVelChange1 = velocityInPlane2 + x * sampleVelChange2
-        // x * (sampleVelChange1 - sampleVelChange2) = velocityInPlane2 - velocityInPlane1
-        // x = (velocityInPlane2 - velocityInPlane1).(sampleVelChange1 - sampleVelChange2) / |sampleVelChange1 - sampleVelChange2|^2
-        // ...or velocityInPlane2 - velocityInPlane1 = 0
-        float x = dotProduct(velDif, sampleVelChange1 - sampleVelChange2)
-            / dotProduct(sampleVelChange1 - sampleVelChange2, sampleVelChange1 - sampleVelChange2);
-        if (!isnan(x)) {
-            float factor = 1.0f - first.getCorFactorTang() * other.getCorFactorTang();
-            first.velocity += factor * x * sampleVelChange1;
-            other.velocity += factor * x * sampleVelChange2;
+        // Objects can be created or destroyed by onCollision, which can move bodies around the table, so they are found again by handle
+        collided.clear();
+        cellsHit.clear();
+        for (auto& contact : contacts) {
+            collided.push_back(contact.a->getHandle());
+            collided.push_back(contact.b->getHandle());
+            if (contact.cell >= 0)
+                cellsHit.emplace_back(contact.a->tileGrid != noTileGrid ? contact.a->getHandle() : contact.b->getHandle(), contact.cell);
+        }
+        toCheck.clear();
+        for (auto ptr : participants)
+            toCheck.push_back(ptr->getHandle());
+        for (auto handle : collided) {
+            if (Body* body = getBody(handle))
+                body->owner->onCollision();
+        }
+        for (auto& [handle, cell] : cellsHit) {
+            if (Body* body = getBody(handle)) {
+                unsigned int columns = tileGrids[body->tileGrid].columns;
+                body->owner->onCellCollision(cell % columns, cell / columns);
+            }
+        }
+        for (auto handle : toCheck) {
+            if (Body* body = getBody(handle))
+                body->checkForNextCollision();
         }
 
-        first.onCollision();
-        other.onCollision();
-        first.checkForNextCollision();
-        other.checkForNextCollision();
+        if (stopAtCollision) {
+            end = time;
+            break;
+        }
     }
 
     // Let everything finish its timestep
-    // Reset timeAhead and decrease timeOfCollision by 1
-    for (auto ptr : collidables) {
-        ptr->location += ptr->velocity * (1 - ptr->timeAhead);
-        ptr->timeAhead = 0.0f;
-        if (ptr->timeOfCollision != INFINITY) // Check that there is a real collision. Probably not needed due to error in float at this size.
-            ptr->timeOfCollision -= 1.0f; // Changing the multiset's sorting value, only okay because the order is the same at the end (all values > 1)
+    // Reset timeAhead and decrease timeOfCollision by the time gone
+    for (auto index : collidables) {
+        Body& body = bodies[index];
+        if (body.timeAhead < end) {
+            body.location += body.velocity * (end - body.timeAhead);
+            body.timeAhead = 0.0f;
+        }
+        else {
+            body.timeAhead -= end; // Held back past a collision that was stopped at
+        }
+        if (body.timeOfCollision != INFINITY) // Check that there is a real collision. Probably not needed due to error in float at this size.
+            body.timeOfCollision -= end; // Changing the multiset's sorting value, only okay because the order is the same at the end (all values >= end)
+        for (auto& scheduled : body.scheduledVelocities)
+            scheduled.time -= end;
+        body.lastCollisionTime -= end;
+        body.neighbourListExpiry -= end;
+    }
+
+    statistics.heapAllocationsLastTick = static_cast<unsigned int>(heap.getAllocations() - heapAllocationsBefore);
+    statistics.heapAllocations = heap.getAllocations();
+    statistics.heapBytesInUse = heap.getBytesInUse();
+    statistics.precisionFallbacks += precisionFallbacks - precisionFallbacksBefore;
+    return end;
+}
+
+void CollisionWorld::setCollisionEventRecording(bool record) {
+    recordingCollisionEvents = record;
+    if (!record)
+        collisionEvents.clear();
+}
+
+// The push along forceVec, which points from b towards a, that bounces two objects apart as a contact on its own. A resting contact
+// stops them, and any other bounces them by how bouncy both are. Not normal or negative if they can't be bounced
+static float bounceImpulse(const float2& velocityA, const float2& velocityB, const float2& forceVec, const Matrix2x2& inverseMassA,
+    const Matrix2x2& inverseMassB, float corFactorPerpA, float corFactorPerpB, bool resting) {
+    float X = -2 * dotProduct(velocityA - velocityB, forceVec) / dotProduct(forceVec, (inverseMassA + inverseMassB) * forceVec);
+    if (resting)
+        return X / 2; // Coefficient of restitution of 0
+    X *= (1 + corFactorPerpA) / 2;
+    X *= (1 + corFactorPerpB) / 2;
+    return X;
+}
+
+// Tangential part of a bounce, once the objects have been pushed apart along forceVec. Friction takes away 'factor' of the difference
+// in their velocities along the surface, shared between them by their masses
+static void applyFriction(float2& velocityA, float2& velocityB, const float2& forceVec, const Matrix2x2& inverseMassA,
+    const Matrix2x2& inverseMassB, float factor) {
+    float2 velocityInPlane1 = velocityA - forceVec * dotProduct(velocityA, forceVec) / dotProduct(forceVec, forceVec);
+    float2 velocityInPlane2 = velocityB - forceVec * dotProduct(velocityB, forceVec) / dotProduct(forceVec, forceVec);
+    float2 velDif = velocityInPlane2 - velocityInPlane1; // Direction of force
+    float2 sampleVelChange1 = inverseMassA * velDif;
+    float2 sampleVelChange2 = -(inverseMassB * velDif);
+    // For CoR = 0:
+    // velocityInPlane1 + x * sampleVelChange1 = velocityInPlane2 + x * sampleVelChange2
+    // x * (sampleVelChange1 - sampleVelChange2) = velocityInPlane2 - velocityInPlane1
+    // x = (velocityInPlane2 - velocityInPlane1).(sampleVelChange1 - sampleVelChange2) / |sampleVelChange1 - sampleVelChange2|^2
+    // ...or velocityInPlane2 - velocityInPlane1 = 0
+    float x = dotProduct(velDif, sampleVelChange1 - sampleVelChange2)
+        / dotProduct(sampleVelChange1 - sampleVelChange2, sampleVelChange1 - sampleVelChange2);
+    if (!std::isnan(x)) {
+        velocityA += factor * x * sampleVelChange1;
+        velocityB += factor * x * sampleVelChange2;
     }
 }
 
-LineAndCircleBoundedCollidable::LineAndCircleBoundedCollidable(const float2& initLocation, const float2& initVelocity)
-    : location{ initLocation }, velocity{ initVelocity }, timeAhead{ 0.0f }, timeOfCollision{ 0.0f }, nextPossibleCollision{ nullptr }, forceVec{ 0.0f,0.0f }
+void CollisionWorld::resolveContacts(std::pmr::vector<Contact>& contacts) {
+    // Point each force so that the objects are moving towards each other along it
+    for (auto& contact : contacts) {
+        contact.initialSpeed = dotProduct(contact.a->velocity - contact.b->velocity, contact.forceVec);
+        if (contact.initialSpeed > 0) {
+            contact.forceVec = -contact.forceVec;
+            contact.initialSpeed = -contact.initialSpeed;
+        }
+    }
+
+    // Perpendicular part of bounce
+    // Each contact first gets the bounce it would have on its own
+    for (auto& contact : contacts) {
+        Body& first = *contact.a;
+        Body& other = *contact.b;
+        float2& forceVec = contact.forceVec;
+
+        float X = bounceImpulse(first.velocity, other.velocity, forceVec, first.owner->getInverseMassMatrix(), other.owner->getInverseMassMatrix(),
+            first.owner->getCorFactorPerp(), other.owner->getCorFactorPerp(), contact.resting);
+        if (contact.resting) {
+            ++statistics.restingContacts;
+            contact.finalSpeed = 0.0f;
+        }
+        else {
+            contact.finalSpeed = -contact.initialSpeed * ((1 + first.owner->getCorFactorPerp()) * (1 + other.owner->getCorFactorPerp()) / 2 - 1);
+        }
+
+        if (!std::isnormal(X) || X < 0) { // Check X was calculated fine
+            if (&contact == &contacts.front() && !contact.resting) {
+                //X = 0.0f; // This case is a problem
+                throw "Cannot calculate new trajectories, X = " + std::to_string(X);
+            }
+            X = 0.0f; // Already moving apart, possibly because of another contact
+        }
+        contact.impulse = X;
+
+        first.velocity += first.owner->getInverseMassMatrix() * (X * forceVec);
+        other.velocity -= other.owner->getInverseMassMatrix() * (X * forceVec);
+    }
+
+    // Contacts sharing an object affect each other, so they are corrected until they all bounce properly together.
+    // The total impulse on each contact can only push objects apart
+    if (contacts.size() > 1) {
+        for (int pass = 0; pass < contactSolverPasses; ++pass) {
+            for (auto& contact : contacts) {
+                Body& first = *contact.a;
+                Body& other = *contact.b;
+                float2& forceVec = contact.forceVec;
+                float resistance = dotProduct(forceVec, (first.owner->getInverseMassMatrix() + other.owner->getInverseMassMatrix()) * forceVec);
+                if (!(resistance > 0))
+                    continue;
+                float speed = dotProduct(first.velocity - other.velocity, forceVec);
+                float newImpulse = contact.impulse + (contact.finalSpeed - speed) / resistance;
+                if (newImpulse < 0)
+                    newImpulse = 0.0f;
+                float X = newImpulse - contact.impulse;
+                contact.impulse = newImpulse;
+                first.velocity += first.owner->getInverseMassMatrix() * (X * forceVec);
+                other.velocity -= other.owner->getInverseMassMatrix() * (X * forceVec);
+            }
+        }
+    }
+
+    // Tangential part of bounce
+    for (auto& contact : contacts) {
+        Body& first = *contact.a;
+        Body& other = *contact.b;
+        applyFriction(first.velocity, other.velocity, contact.forceVec, first.owner->getInverseMassMatrix(), other.owner->getInverseMassMatrix(),
+            1.0f - first.owner->getCorFactorTang() * other.owner->getCorFactorTang());
+    }
+    for (auto& contact : contacts) {
+        spatialGrid.noteVelocity(contact.a->velocity);
+        spatialGrid.noteVelocity(contact.b->velocity);
+    }
+}
+
+void CollisionWorld::Body::gatherSimultaneousContacts(float time, std::pmr::vector<Contact>& contacts) {
+    for (auto handle : simultaneousCollisions) {
+        Body* other = world->getBody(handle);
+        if (!other) // Destroyed since it was found
+            continue;
+        bool alreadyIncluded = false;
+        for (auto& contact : contacts) {
+            if ((contact.a == this && contact.b == other) || (contact.a == other && contact.b == this))
+                alreadyIncluded = true;
+        }
+        if (alreadyIncluded)
+            continue;
+
+        // Either object may have changed trajectory since this was found, so check it again
+        float2 contactForceVec;
+        int contactCell;
+        ++world->statistics.pairTests;
+        if (timeToCollisionWith(*other, contactForceVec, contactCell, time + simultaneousCollisionTime) <= time + simultaneousCollisionTime && dotProduct(contactForceVec, contactForceVec) != 0)
+            contacts.push_back(Contact{ this,other,contactForceVec,contactCell });
+    }
+}
+
+unsigned int CollisionWorld::Body::countRepeatedCollision(float time) {
+    float interval = time - lastCollisionTime;
+    if (interval <= repeatedCollisionTime && interval * std::sqrt(dotProduct(velocity, velocity)) <= repeatedCollisionDistance)
+        ++repeatedCollisions;
+    else
+        repeatedCollisions = 0;
+    lastCollisionTime = time;
+    return repeatedCollisions;
+}
+
+void CollisionWorld::holdBackRemainingEvents(float until) {
+    // Stops everything that still has a collision this tick where it is, so that nothing passes through anything else.
+    // They are put at the front of the list to be checked again at the start of the next tick
+    ++statistics.budgetExceededTicks;
+    heldBack.clear();
+    for (auto index : collidables) {
+        if (bodies[index].timeOfCollision >= until)
+            break;
+        heldBack.push_back(&bodies[index]);
+    }
+    for (auto ptr : heldBack) {
+        ptr->unpair();
+        ptr->timeAhead = until; // Stays at its current location for the rest of the tick
+        ptr->updateListPosition(until);
+        ++statistics.objectsHeldBack;
+    }
+}
+
+LineAndCircleBoundedCollidable::LineAndCircleBoundedCollidable(CollisionWorld& world, const float2& initLocation, const float2& initVelocity)
+    : world{ &world }
 {
-    collidables.insert(this);
+    // Reuse a free slot if there is one, with a new generation so that old handles to it stop working
+    uint32_t index;
+    uint32_t generation = 1;
+    if (!world.freeSlots.empty()) {
+        index = world.freeSlots.back();
+        world.freeSlots.pop_back();
+        generation = world.bodies[index].generation % maxGeneration + 1; // Never 0, so that no handle is 0
+    }
+    else {
+        if (world.bodies.size() > slotIndexMask)
+            throw "Too many collidable objects";
+        index = static_cast<uint32_t>(world.bodies.size());
+        world.bodies.emplace_back(&world);
+    }
+
+    Body& body = world.bodies[index];
+    body.owner = this;
+    body.generation = generation;
+    body.location = initLocation;
+    body.velocity = initVelocity;
+    body.timeOfCollision = 0.0f;
+    body.timeAhead = 0.0f;
+    body.nextPossibleCollision = BodyHandle{};
+    body.firstLine = 0;
+    body.lineCount = 0;
+    body.firstCircle = 0;
+    body.circleCount = 0;
+    body.forceVec = { 0.0f,0.0f };
+    body.contactCell = -1;
+    body.tileGrid = noTileGrid;
+    body.staticMesh = noStaticMesh;
+    body.lastCollisionTime = -INFINITY;
+    body.repeatedCollisions = 0;
+    body.boundingRadius = 0.0f;
+    body.neighbourListCentre = initLocation;
+    body.neighbourListExpiry = -INFINITY;
+    body.neighbourListValid = false;
+    handle = body.getHandle();
+
+    world.collidables.insert(index);
+    world.spatialGrid.valid = false;
 }
 
 LineAndCircleBoundedCollidable::~LineAndCircleBoundedCollidable()
 {
-    // Remove self from collidables list
-    collidables.erase(this);
-
-    // Unpair
-    if (nextPossibleCollision) {
-        nextPossibleCollision->nextPossibleCollision = nullptr;
-        nextPossibleCollision->forceVec = { 0.0f,0.0f };
-    }
+    world->destroyBody(handle);
 }
 
 LineAndCircleBoundedCollidable::LineAndCircleBoundedCollidable(LineAndCircleBoundedCollidable&& other) noexcept
-    : location{ other.location }, velocity{ other.velocity }, timeAhead{ other.timeAhead }, timeOfCollision{ 0.0f },
-    nextPossibleCollision{ other.nextPossibleCollision }, lines{ std::move(other.lines) }, circles{ std::move(other.circles) }, forceVec{ 0.0f,0.0f }
+    : world{ other.world }, handle{ other.handle }
 {
-    // Update pointer of paired object
-    other.nextPossibleCollision = nullptr;
-    if (nextPossibleCollision)
-        nextPossibleCollision->nextPossibleCollision = this;
-
-    // Add self to list
-    collidables.insert(this);
-    updateListPosition(other.timeOfCollision);
+    other.handle = BodyHandle{};
+    if (Body* body = world->getBody(handle))
+        body->owner = this;
 }
 
 LineAndCircleBoundedCollidable& LineAndCircleBoundedCollidable::operator=(LineAndCircleBoundedCollidable&& other) noexcept
 {
-    // Unpair
-    if (nextPossibleCollision) {
-        nextPossibleCollision->nextPossibleCollision = nullptr;
-        nextPossibleCollision->forceVec = { 0.0f,0.0f };
+    if (this != &other) {
+        world->destroyBody(handle);
+        world = other.world;
+        handle = other.handle;
+        other.handle = BodyHandle{};
+        if (Body* body = world->getBody(handle))
+            body->owner = this;
     }
+    return *this;
+}
 
-    // Copy and move members
-    location = other.location;
-    velocity = other.velocity;
-    timeAhead = other.timeAhead;
-    nextPossibleCollision = other.nextPossibleCollision;
-    forceVec = other.forceVec;
-    lines = std::move(other.lines);
-    circles = std::move(other.circles);
+void CollisionWorld::destroyBody(BodyHandle handle) {
+    Body* body = getBody(handle);
+    if (!body) // Moved from
+        return;
 
-    // Update pointer of new paired object
-    other.nextPossibleCollision = nullptr;
-    if (nextPossibleCollision)
-        nextPossibleCollision->nextPossibleCollision = this;
+    // Remove self from collidables list
+    collidables.erase(body->getIndex());
+    removeFromGrid(body->getIndex());
 
-    // Move to correct point in list
-    updateListPosition(other.timeOfCollision);
+    body->unpair();
+    body->removeFromNeighbourLists();
+    // Other objects' simultaneous collisions may still have the handle, but it won't find anything once the slot is freed
+    body->simultaneousCollisions.clear();
+    body->scheduledVelocities.clear();
 
-    return *this;
+    // Leave a gap in the stores
+    unusedShapes += body->lineCount + body->circleCount;
+    if (body->tileGrid != noTileGrid) {
+        tileGrids[body->tileGrid].cells.clear();
+        freeTileGrids.push_back(body->tileGrid);
+    }
+    freeStaticMesh(*body);
+
+    body->owner = nullptr;
+    freeSlots.push_back(body->getIndex());
+
+    if (collidables.empty())
+        releaseMemory();
+}
+
+void CollisionWorld::releaseMemory() {
+    // Nothing uses the pool once every object is gone, e.g. when a level is cleared, so all of it goes back at once.
+    // The containers are swapped with empty ones first, so that they don't hold on to any of it. The slot table isn't in the pool and
+    // is kept, every slot now free, so that slots carry on from their generations and old handles never match a new object
+    for (auto& body : bodies) {
+        decltype(body.scheduledVelocities)(&pool).swap(body.scheduledVelocities);
+        decltype(body.simultaneousCollisions)(&pool).swap(body.simultaneousCollisions);
+        decltype(body.neighbours)(&pool).swap(body.neighbours);
+    }
+    decltype(lineStore)(&pool).swap(lineStore);
+    decltype(circleStore)(&pool).swap(circleStore);
+    decltype(tileGrids)(&pool).swap(tileGrids);
+    decltype(freeTileGrids)(&pool).swap(freeTileGrids);
+    decltype(staticMeshes)(&pool).swap(staticMeshes);
+    decltype(freeStaticMeshes)(&pool).swap(freeStaticMeshes);
+    decltype(spatialGrid.cellFirst)(&pool).swap(spatialGrid.cellFirst);
+    decltype(spatialGrid.bodyCell)(&pool).swap(spatialGrid.bodyCell);
+    decltype(spatialGrid.bodyNext)(&pool).swap(spatialGrid.bodyNext);
+    decltype(spatialGrid.largeBodies)(&pool).swap(spatialGrid.largeBodies);
+    decltype(spatialGrid.radii)(&pool).swap(spatialGrid.radii);
+    spatialGrid.valid = false;
+    unusedShapes = 0;
+    pool.release();
+    ++statistics.memoryReleases;
+    statistics.heapBytesInUse = heap.getBytesInUse();
+}
+
+void* CountingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    ++allocations;
+    bytesInUse += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void CountingMemoryResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    bytesInUse -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+CollisionWorld::Body& LineAndCircleBoundedCollidable::body() const {
+    return world->bodies[handle.id & slotIndexMask];
+}
+
+CollisionWorld::Body* CollisionWorld::getBody(BodyHandle handle) {
+    uint32_t index = handle.id & slotIndexMask;
+    if (!handle || index >= bodies.size())
+        return nullptr;
+    Body& body = bodies[index];
+    if (!body.owner || body.generation != handle.id >> slotIndexBits)
+        return nullptr;
+    return &body;
+}
+
+BodyHandle CollisionWorld::Body::getHandle() const {
+    return BodyHandle{ generation << slotIndexBits | getIndex() };
+}
+
+uint32_t CollisionWorld::Body::getIndex() const {
+    return static_cast<uint32_t>(this - world->bodies.data());
+}
+
+void CollisionWorld::Body::unpair() {
+    if (Body* other = world->getBody(nextPossibleCollision)) {
+        other->nextPossibleCollision = BodyHandle{};
+        other->forceVec = { 0.0f,0.0f };
+        other->contactCell = -1;
+    }
+    nextPossibleCollision = BodyHandle{};
+    forceVec = { 0.0f,0.0f };
+    contactCell = -1;
 }
 
 void LineAndCircleBoundedCollidable::changeTrajectory(const float2& newLocation, const float2& newVelocity) {
+    body().changeTrajectory(newLocation, newVelocity);
+}
+
+void CollisionWorld::Body::changeTrajectory(const float2& newLocation, const float2& newVelocity) {
     location = newLocation;
     velocity = newVelocity;
-
-    // Unpair
-    if (nextPossibleCollision) {
-        nextPossibleCollision->nextPossibleCollision = nullptr;
-        nextPossibleCollision->forceVec = { 0.0f,0.0f };
+    // A jump further than the neighbour list allows for, e.g. a ball put back at the start, means the list has to be rebuilt. The
+    // object is moved in the grid straight away, so that it is found where it is now until then
+    float allowedMovement = world->neighbourSkin / 3;
+    float2 moved = location - neighbourListCentre;
+    if (dotProduct(moved, moved) >= allowedMovement * allowedMovement) {
+        neighbourListValid = false;
+        neighbourListCentre = location;
+        world->moveInGrid(getIndex());
     }
-    nextPossibleCollision = nullptr;
+    world->spatialGrid.noteVelocity(velocity);
+    unpair();
     updateListPosition(timeAhead);
 }
 
 void LineAndCircleBoundedCollidable::changeVelocity(const float2& newVelocity) {
-    changeTrajectory(location, newVelocity);
+    changeTrajectory(body().location, newVelocity);
+}
+
+void LineAndCircleBoundedCollidable::scheduleVelocityChange(float time, const float2& newVelocity) {
+    body().scheduleVelocityChange(time, newVelocity);
+}
+
+void CollisionWorld::Body::scheduleVelocityChange(float time, const float2& newVelocity) {
+    auto it = scheduledVelocities.begin();
+    while (it != scheduledVelocities.end() && it->time <= time)
+        ++it;
+    scheduledVelocities.insert(it, ScheduledVelocity{ time,newVelocity });
+
+    if (time < timeOfCollision) { // Any collision found is after the change, so is no longer valid
+        unpair();
+        updateListPosition(time > timeAhead ? time : timeAhead);
+    }
+}
+
+void LineAndCircleBoundedCollidable::schedulePath(const std::vector<std::pair<float, float2>>& waypoints) {
+    clearScheduledVelocityChanges();
+    if (waypoints.empty())
+        return;
+
+    // Positions are only known from the current location at timeAhead, which is where the path starts
+    float startTime = body().timeAhead;
+    float prevTime = startTime;
+    float2 prevLocation = body().location;
+    for (auto& [time, waypoint] : waypoints) {
+        float2 segmentVelocity = time > prevTime ? (waypoint - prevLocation) / (time - prevTime) : float2{ 0.0f,0.0f };
+        if (prevTime == startTime)
+            changeVelocity(segmentVelocity);
+        else
+            scheduleVelocityChange(prevTime, segmentVelocity);
+        prevTime = time;
+        prevLocation = waypoint;
+    }
+    scheduleVelocityChange(prevTime, { 0.0f,0.0f });
+}
+
+void LineAndCircleBoundedCollidable::clearScheduledVelocityChanges() {
+    body().scheduledVelocities.clear();
+}
+
+void CollisionWorld::Body::applyScheduledVelocity() {
+    // Step to the time of the change, then continue with the new velocity
+    ScheduledVelocity next = scheduledVelocities.front();
+    scheduledVelocities.erase(scheduledVelocities.begin());
+    if (next.time > timeAhead) {
+        location += velocity * (next.time - timeAhead);
+        timeAhead = next.time;
+    }
+    changeTrajectory(location, next.velocity);
 }
 
 void LineAndCircleBoundedCollidable::addLine(const float2& p1, const float2& p2) {
-    lines.emplace_back(Line{ p1,p2 });
-    updateListPosition(timeAhead);
+    CollisionWorld& world = *this->world;
+    Body& body = this->body();
+    // An object's lines are kept together, so they are moved to the end of the store if something is after them
+    if (body.firstLine + body.lineCount != world.lineStore.size()) {
+        size_t newFirstLine = world.lineStore.size();
+        for (unsigned int i = 0; i < body.lineCount; ++i)
+            world.lineStore.push_back(world.lineStore[body.firstLine + i]);
+        body.firstLine = static_cast<unsigned int>(newFirstLine);
+        world.unusedShapes += body.lineCount;
+    }
+    world.lineStore.push_back(Line{ p1,p2 });
+    ++body.lineCount;
+    world.freeStaticMesh(body);
+    body.boundingRadius = std::max({ body.boundingRadius,std::sqrt(dotProduct(p1, p1)),std::sqrt(dotProduct(p2, p2)) });
+    body.neighbourListValid = false;
+    world.spatialGrid.valid = false;
+    body.updateListPosition(body.timeAhead);
 }
 
 void LineAndCircleBoundedCollidable::addCircle(const float2& centre, float radius) {
-    circles.emplace_back(Circle{ centre,radius });
-    updateListPosition(timeAhead);
+    CollisionWorld& world = *this->world;
+    Body& body = this->body();
+    if (body.firstCircle + body.circleCount != world.circleStore.size()) {
+        size_t newFirstCircle = world.circleStore.size();
+        for (unsigned int i = 0; i < body.circleCount; ++i)
+            world.circleStore.push_back(world.circleStore[body.firstCircle + i]);
+        body.firstCircle = static_cast<unsigned int>(newFirstCircle);
+        world.unusedShapes += body.circleCount;
+    }
+    world.circleStore.push_back(Circle{ centre,radius });
+    ++body.circleCount;
+    world.freeStaticMesh(body);
+    body.boundingRadius = std::max(body.boundingRadius, std::sqrt(dotProduct(centre, centre)) + radius);
+    body.neighbourListValid = false;
+    world.spatialGrid.valid = false;
+    body.updateListPosition(body.timeAhead);
+}
+
+void LineAndCircleBoundedCollidable::makeTileGrid(const float2& topLeft, const float2& cellSize, unsigned int columns, unsigned int rows, float fill) {
+    CollisionWorld& world = *this->world;
+    Body& body = this->body();
+    if (body.tileGrid == noTileGrid) {
+        if (!world.freeTileGrids.empty()) {
+            body.tileGrid = world.freeTileGrids.back();
+            world.freeTileGrids.pop_back();
+        }
+        else {
+            body.tileGrid = static_cast<uint32_t>(world.tileGrids.size());
+            world.tileGrids.emplace_back(&world.pool);
+        }
+    }
+    CollisionWorld::TileGrid& grid = world.tileGrids[body.tileGrid];
+    grid.topLeft = topLeft;
+    grid.cellSize = cellSize;
+    grid.fill = fill;
+    grid.columns = columns;
+    grid.rows = rows;
+    grid.cells.assign(columns * rows, 0);
+
+    float2 size = { columns * cellSize.x,rows * cellSize.y };
+    for (float2 corner : { topLeft,topLeft + float2{ size.x,0.0f },topLeft - float2{ 0.0f,size.y },topLeft + float2{ size.x,-size.y } })
+        body.boundingRadius = std::max(body.boundingRadius, std::sqrt(dotProduct(corner, corner)));
+    body.neighbourListValid = false;
+    world.spatialGrid.valid = false;
+    body.updateListPosition(body.timeAhead);
+}
+
+void LineAndCircleBoundedCollidable::setCell(unsigned int column, unsigned int row, unsigned char health) {
+    CollisionWorld& world = *this->world;
+    Body& body = this->body();
+    if (body.tileGrid == noTileGrid)
+        throw "Object has no tile grid";
+    CollisionWorld::TileGrid& grid = world.tileGrids[body.tileGrid];
+    if (column >= grid.columns || row >= grid.rows)
+        throw "Cell is outside the tile grid";
+    int cell = row * grid.columns + column;
+    bool wasEmpty = grid.cells[cell] == 0;
+    grid.cells[cell] = health;
+
+    // Emptying a cell only matters if the next collision found was with it. A new cell could be hit before anything else is, so the
+    // grid checks again. Whatever it then finds first is paired with it, and the rest are corrected in turn as the grid is hit
+    if ((wasEmpty && health != 0) || (health == 0 && body.contactCell == cell))
+        body.changeTrajectory(body.location, body.velocity);
+}
+
+unsigned char LineAndCircleBoundedCollidable::getCell(unsigned int column, unsigned int row) const {
+    const Body& body = this->body();
+    if (body.tileGrid == noTileGrid)
+        throw "Object has no tile grid";
+    const CollisionWorld::TileGrid& grid = world->tileGrids[body.tileGrid];
+    if (column >= grid.columns || row >= grid.rows)
+        throw "Cell is outside the tile grid";
+    return grid.cells[row * grid.columns + column];
+}
+
+void LineAndCircleBoundedCollidable::bakeStaticMesh() {
+    CollisionWorld& world = *this->world;
+    Body& body = this->body();
+    if (body.staticMesh == noStaticMesh) {
+        if (!world.freeStaticMeshes.empty()) {
+            body.staticMesh = world.freeStaticMeshes.back();
+            world.freeStaticMeshes.pop_back();
+        }
+        else {
+            body.staticMesh = static_cast<uint32_t>(world.staticMeshes.size());
+            world.staticMeshes.emplace_back(&world.pool);
+        }
+    }
+    CollisionWorld::StaticMesh& mesh = world.staticMeshes[body.staticMesh];
+    mesh.nodes.clear();
+    mesh.shapes.clear();
+
+    auto& shapeBoxes = world.shapeBoxes;
+    shapeBoxes.clear();
+    for (auto& line : body.getLines()) {
+        shapeBoxes.emplace_back(float2{ std::min(line.p1.x, line.p2.x),std::min(line.p1.y, line.p2.y) },
+            float2{ std::max(line.p1.x, line.p2.x),std::max(line.p1.y, line.p2.y) });
+    }
+    for (auto& circle : body.getCircles())
+        shapeBoxes.emplace_back(circle.centre - float2{ circle.radius,circle.radius }, circle.centre + float2{ circle.radius,circle.radius });
+    if (shapeBoxes.empty())
+        return;
+    for (uint32_t i = 0; i < shapeBoxes.size(); ++i)
+        mesh.shapes.push_back(i);
+    mesh.nodes.reserve(2 * shapeBoxes.size() / meshLeafSize + 1);
+    CollisionWorld::buildMeshNode(mesh, shapeBoxes, 0, static_cast<uint32_t>(shapeBoxes.size()));
+}
+
+uint32_t CollisionWorld::buildMeshNode(StaticMesh& mesh, const std::pmr::vector<std::pair<float2, float2>>& shapeBoxes,
+    uint32_t firstShape, uint32_t shapeCount) {
+    uint32_t index = static_cast<uint32_t>(mesh.nodes.size());
+    mesh.nodes.emplace_back();
+    auto begin = mesh.shapes.begin() + firstShape;
+    auto end = begin + shapeCount;
+
+    float2 low = shapeBoxes[*begin].first;
+    float2 high = shapeBoxes[*begin].second;
+    float2 lowCentre = (low + high) / 2;
+    float2 highCentre = lowCentre;
+    for (auto it = begin; it != end; ++it) {
+        auto& [shapeLow, shapeHigh] = shapeBoxes[*it];
+        float2 centre = (shapeLow + shapeHigh) / 2;
+        low = { std::min(low.x, shapeLow.x),std::min(low.y, shapeLow.y) };
+        high = { std::max(high.x, shapeHigh.x),std::max(high.y, shapeHigh.y) };
+        lowCentre = { std::min(lowCentre.x, centre.x),std::min(lowCentre.y, centre.y) };
+        highCentre = { std::max(highCentre.x, centre.x),std::max(highCentre.y, centre.y) };
+    }
+    mesh.nodes[index] = MeshNode{ low,high,firstShape,shapeCount,0 };
+    if (shapeCount <= meshLeafSize || highCentre == lowCentre) // Can't be split any further if every shape has the same centre
+        return index;
+
+    // Split the shapes in half along the longer side of the box around their centres
+    bool alongX = highCentre.x - lowCentre.x >= highCentre.y - lowCentre.y;
+    auto middle = begin + shapeCount / 2;
+    std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+        float2 centreA = shapeBoxes[a].first + shapeBoxes[a].second;
+        float2 centreB = shapeBoxes[b].first + shapeBoxes[b].second;
+        return alongX ? centreA.x < centreB.x : centreA.y < centreB.y;
+    });
+    mesh.nodes[index].shapeCount = 0;
+    buildMeshNode(mesh, shapeBoxes, firstShape, shapeCount / 2);
+    uint32_t secondChild = buildMeshNode(mesh, shapeBoxes, firstShape + shapeCount / 2, shapeCount - shapeCount / 2);
+    mesh.nodes[index].secondChild = secondChild;
+    return index;
+}
+
+void CollisionWorld::freeStaticMesh(Body& body) {
+    if (body.staticMesh == noStaticMesh)
+        return;
+    staticMeshes[body.staticMesh].nodes.clear();
+    staticMeshes[body.staticMesh].shapes.clear();
+    freeStaticMeshes.push_back(body.staticMesh);
+    body.staticMesh = noStaticMesh;
+}
+
+// Notes in closeCall if a decision was made on a difference this close to zero, compared to the sizes involved, where float could
+// have got it wrong. Exactly zero comes from shapes exactly lined up with each other or with the velocity, e.g. the bat sliding along
+// a wall, which float gets right. Only float is checked, as double is what those results are worked out again in
+template <typename Scalar>
+static void checkCloseCall(Scalar difference, Scalar scale, bool& closeCall) {
+    if constexpr (std::is_same_v<Scalar, float>) {
+        if (difference != 0 && std::fabs(difference) < closeCallTolerance * scale)
+            closeCall = true;
+    }
 }
 
 // Takes a line positioned relative to a point, and the velocity of the line relative to the point
 // Returns the time that the line collides with the point
 // Returns NaN if there is no collision
 // Returns a negative number if the collision started/happened in the past
-float pointLineTimeToCollision(const Line& line, const float2& relativeVelocity) {
+template <typename Scalar>
+static Scalar pointLineTimeToCollision(const LineOf<Scalar>& line, const Vector2<Scalar>& relativeVelocity, bool& closeCall) {
     // Find whether the line will hit the origin or not, then find time.
     // Points on line can be written as: line.p1 + x * (line.p2 - line.p1), where 0 <= x <= 1
     // For point that hits the origin:
     // (lineP1 + x * (lineP2 - lineP1)).relativeVelocityPerp = 0
     // x = -lineP1.relativeVelocityPerp / (lineP2 - lineP1).relativeVelocityPerp
     // If 0 <= x <= 1, there is a hit. Else, miss
-    float2 relativeVelocityPerp = { relativeVelocity.y,-relativeVelocity.x };
-    float x = dotProduct(-line.p1, relativeVelocityPerp) / dotProduct((line.p2 - line.p1), relativeVelocityPerp);
+    Vector2<Scalar> relativeVelocityPerp = { relativeVelocity.y,-relativeVelocity.x };
+    Scalar denominator = dotProduct((line.p2 - line.p1), relativeVelocityPerp);
+    Scalar x = dotProduct(-line.p1, relativeVelocityPerp) / denominator;
+    // Only just hitting an end, or nearly parallel to the velocity and not clearly missing, since x is then only roughly right. The
+    // second is compared squared, so the scale has the tolerance in it once more
+    if (!(x < -1 || x > 2)) {
+        checkCloseCall(denominator * denominator, closeCallTolerance * dotProduct(line.p2 - line.p1, line.p2 - line.p1)
+            * dotProduct(relativeVelocityPerp, relativeVelocityPerp), closeCall);
+    }
+    checkCloseCall(x, Scalar(1), closeCall);
+    checkCloseCall(x - 1, Scalar(1), closeCall);
     if (x < 0 || x > 1) {
         return NAN;
     }
@@ -272,22 +909,30 @@ float pointLineTimeToCollision(const Line& line, const float2& relativeVelocity)
 // Returns the time at which the lines will begin to intersect
 // Will return zero if the lines are currently intersecting, and are closer to when the intersection started than when it will finish
 // Returns Inf is there is no collision, or if the normals are in the wrong direction
-float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeVelocity, float2* const forceVec = nullptr) { // Completely broken rn
+template <typename Scalar>
+static Scalar timeToCollisionLines(const LineOf<Scalar>& a, const LineOf<Scalar>& b, const Vector2<Scalar>& relativeVelocity,
+    Vector2<Scalar>* const forceVec, bool& closeCall) {
     // Find time at which point intersects with parallelogram
 
     // Check that velocity is in direction of outwards line normal. If not, ignore collision.
     // (This is to handle the case of parallel lines that have managed to step past each other)
-    if (dotProduct(relativeVelocity, { -(b.p2.y - b.p1.y),b.p2.x - b.p1.x }) < 0
-        || dotProduct(relativeVelocity, { -(a.p2.y - a.p1.y),a.p2.x - a.p1.x }) > 0) {
+    Vector2<Scalar> normalA = { -(a.p2.y - a.p1.y),a.p2.x - a.p1.x };
+    Vector2<Scalar> normalB = { -(b.p2.y - b.p1.y),b.p2.x - b.p1.x };
+    Scalar speedSq = dotProduct(relativeVelocity, relativeVelocity);
+    checkCloseCall(dotProduct(relativeVelocity, normalA) * dotProduct(relativeVelocity, normalA),
+        closeCallTolerance * speedSq * dotProduct(normalA, normalA), closeCall);
+    checkCloseCall(dotProduct(relativeVelocity, normalB) * dotProduct(relativeVelocity, normalB),
+        closeCallTolerance * speedSq * dotProduct(normalB, normalB), closeCall);
+    if (dotProduct(relativeVelocity, normalB) < 0 || dotProduct(relativeVelocity, normalA) > 0) {
         return INFINITY;
     }
 
-    float earliestTime = INFINITY;
-    float2 earliestForceVec = { 0.0f,0.0f };
-    float minPosTime = INFINITY;
-    float2 minPosForceVec = { 0.0f,0.0f };
-    float time = pointLineTimeToCollision(Line{ b.p2 + a.p1 - a.p2 - a.p1,b.p2 - a.p1 }, relativeVelocity);
-    if (!isnan(time)) { // If collision
+    Scalar earliestTime = INFINITY;
+    Vector2<Scalar> earliestForceVec = { 0.0f,0.0f };
+    Scalar minPosTime = INFINITY;
+    Vector2<Scalar> minPosForceVec = { 0.0f,0.0f };
+    Scalar time = pointLineTimeToCollision(LineOf<Scalar>{ b.p2 + a.p1 - a.p2 - a.p1,b.p2 - a.p1 }, relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = { a.p1.y - a.p2.y,a.p2.x - a.p1.x }; // Perp to 'a'
             earliestTime = time;
@@ -297,8 +942,8 @@ float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeV
             minPosTime = time;
         }
     }
-    time = pointLineTimeToCollision(Line{ b.p2 - a.p1,b.p1 - a.p1 }, relativeVelocity);
-    if (!isnan(time)) { // If collision
+    time = pointLineTimeToCollision(LineOf<Scalar>{ b.p2 - a.p1,b.p1 - a.p1 }, relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = { b.p1.y - b.p2.y,b.p2.x - b.p1.x }; // Perp to 'b'
             earliestTime = time;
@@ -308,8 +953,8 @@ float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeV
             minPosTime = time;
         }
     }
-    time = pointLineTimeToCollision(Line{ b.p1 - a.p1,b.p1 + a.p1 - a.p2 - a.p1 }, relativeVelocity);
-    if (!isnan(time)) { // If collision
+    time = pointLineTimeToCollision(LineOf<Scalar>{ b.p1 - a.p1,b.p1 + a.p1 - a.p2 - a.p1 }, relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = { a.p1.y - a.p2.y,a.p2.x - a.p1.x }; // Perp to 'a'
             earliestTime = time;
@@ -319,8 +964,8 @@ float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeV
             minPosTime = time;
         }
     }
-    time = pointLineTimeToCollision(Line{ b.p1 + a.p1 - a.p2 - a.p1,b.p2 + a.p1 - a.p2 - a.p1 }, relativeVelocity);
-    if (!isnan(time)) { // If collision
+    time = pointLineTimeToCollision(LineOf<Scalar>{ b.p1 + a.p1 - a.p2 - a.p1,b.p2 + a.p1 - a.p2 - a.p1 }, relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = { b.p1.y - b.p2.y,b.p2.x - b.p1.x }; // Perp to 'b'
             earliestTime = time;
@@ -330,13 +975,14 @@ float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeV
             minPosTime = time;
         }
     }
-    if (isinf(minPosTime)) {
+    if (std::isinf(minPosTime)) {
         if (forceVec)
             *forceVec = { 0.0f,0.0f };
         return INFINITY; // No collision in future
     }
     if (earliestTime <= 0) { // If also collisions happening in the past, then there must be an intersection (because combined shape is convex)
         // <= is needed above so that we can handle the case of a zero-thickness parallelogram here
+        checkCloseCall(-earliestTime - minPosTime, std::max(-earliestTime, minPosTime), closeCall);
         if (-earliestTime < minPosTime) { // If intersection closer to start than finish. Will fail if exactly halfway
             if (forceVec)
                 *forceVec = earliestForceVec;
@@ -357,11 +1003,15 @@ float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeV
 // Will return a negative number if collision would have started/happened in the past
 // Will return NaN if there is no collision
 // Takes the centre of the circle relative to the point, the radius of the circle, and the velocity of the circle relative to the point
-float pointCircleTimeToCollision(const Circle& circle, const float2& relativeVelocity) {
+template <typename Scalar>
+static Scalar pointCircleTimeToCollision(const CircleOf<Scalar>& circle, const Vector2<Scalar>& relativeVelocity, bool& closeCall) {
     // Find whether the point will hit the circle or not, then find time.
-    float2 relVelPerp = { relativeVelocity.y,-relativeVelocity.x };
-    float perpDistanceTimesSpeed = dotProduct(circle.centre, relVelPerp); // Could try scaling vel and velperp vectors to avoid chance of speedSq = 0
-    float speedSq = dotProduct(relativeVelocity, relativeVelocity);
+    Vector2<Scalar> relVelPerp = { relativeVelocity.y,-relativeVelocity.x };
+    Scalar perpDistanceTimesSpeed = dotProduct(circle.centre, relVelPerp); // Could try scaling vel and velperp vectors to avoid chance of speedSq = 0
+    Scalar speedSq = dotProduct(relativeVelocity, relativeVelocity);
+    // Only just grazing the circle
+    checkCloseCall(perpDistanceTimesSpeed * perpDistanceTimesSpeed - circle.radius * circle.radius * speedSq,
+        circle.radius * circle.radius * speedSq, closeCall);
     if (perpDistanceTimesSpeed * perpDistanceTimesSpeed >= circle.radius * circle.radius * speedSq) { // using >= handles case where relativeVelocity is 0
         return NAN; // Miss
     }
@@ -371,22 +1021,24 @@ float pointCircleTimeToCollision(const Circle& circle, const float2& relativeVel
     // Shortening of time due to value of x: sqrt((this->radius + ptr->radius)^2 - x^2) / sqrt(dotProduct(relativeVelocity,relativeVelocity))
     // x^2 = perpDistanceTimesSpeed^2 / dotProduct(relVelPerp, relVelPerp)
     return -dotProduct(circle.centre, relativeVelocity) / speedSq
-        - sqrt((circle.radius * circle.radius - perpDistanceTimesSpeed * perpDistanceTimesSpeed / speedSq) / speedSq);
+        - std::sqrt((circle.radius * circle.radius - perpDistanceTimesSpeed * perpDistanceTimesSpeed / speedSq) / speedSq);
 }
 
 // Takes a circle, a line, and the velocity of the line relative to the circle
 // Returns the time that they collide
 // Returns Inf if there is no collision
-float timeToCollisionCircleLine(const Circle& circle, const Line& line, const float2& relativeVelocity, float2* const forceVec = nullptr) {
+template <typename Scalar>
+static Scalar timeToCollisionCircleLine(const CircleOf<Scalar>& circle, const LineOf<Scalar>& line, const Vector2<Scalar>& relativeVelocity,
+    Vector2<Scalar>* const forceVec, bool& closeCall) {
     // Check for collision of a point with c=) shape
-    const float2 lineVec = line.p2 - line.p1;
-    const float2 lineVecPerp = { lineVec.y,-lineVec.x };
-    float earliestTime = INFINITY;
-    float2 earliestForceVec = { 0.0f,0.0f };
-    float minPosTime = INFINITY;
-    float2 minPosForceVec = { 0.0f,0.0f };
-    float time = pointLineTimeToCollision(line - circle.centre + lineVecPerp * circle.radius / sqrt(dotProduct(lineVecPerp, lineVecPerp)), relativeVelocity);
-    if (!isnan(time)) { // If collision
+    const Vector2<Scalar> lineVec = line.p2 - line.p1;
+    const Vector2<Scalar> lineVecPerp = { lineVec.y,-lineVec.x };
+    Scalar earliestTime = INFINITY;
+    Vector2<Scalar> earliestForceVec = { 0.0f,0.0f };
+    Scalar minPosTime = INFINITY;
+    Vector2<Scalar> minPosForceVec = { 0.0f,0.0f };
+    Scalar time = pointLineTimeToCollision(line - circle.centre + lineVecPerp * circle.radius / std::sqrt(dotProduct(lineVecPerp, lineVecPerp)), relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = { line.p1.y - line.p2.y,line.p2.x - line.p1.x }; // Perp to line
             earliestTime = time;
@@ -396,8 +1048,8 @@ float timeToCollisionCircleLine(const Circle& circle, const Line& line, const fl
             minPosTime = time;
         }
     }
-    time = pointLineTimeToCollision(line - circle.centre - lineVecPerp * circle.radius / sqrt(dotProduct(lineVecPerp, lineVecPerp)), relativeVelocity);
-    if (!isnan(time)) { // If collision
+    time = pointLineTimeToCollision(line - circle.centre - lineVecPerp * circle.radius / std::sqrt(dotProduct(lineVecPerp, lineVecPerp)), relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = { line.p1.y - line.p2.y,line.p2.x - line.p1.x }; // Perp to line
             earliestTime = time;
@@ -407,8 +1059,8 @@ float timeToCollisionCircleLine(const Circle& circle, const Line& line, const fl
             minPosTime = time;
         }
     }
-    time = pointCircleTimeToCollision(circle - line.p1, -relativeVelocity);
-    if (!isnan(time)) { // If collision
+    time = pointCircleTimeToCollision(circle - line.p1, -relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = circle.centre - line.p1 - relativeVelocity * time; // Location of centre of circle at time of collision, relative to p1
             earliestTime = time;
@@ -418,8 +1070,8 @@ float timeToCollisionCircleLine(const Circle& circle, const Line& line, const fl
             minPosTime = time;
         }
     }
-    time = pointCircleTimeToCollision(circle - line.p2, -relativeVelocity);
-    if (!isnan(time)) { // If collision
+    time = pointCircleTimeToCollision(circle - line.p2, -relativeVelocity, closeCall);
+    if (!std::isnan(time)) { // If collision
         if (time < earliestTime) {
             earliestForceVec = circle.centre - line.p2 - relativeVelocity * time; // Location of centre of circle at time of collision, relative to p2
             earliestTime = time;
@@ -429,12 +1081,13 @@ float timeToCollisionCircleLine(const Circle& circle, const Line& line, const fl
             minPosTime = time;
         }
     }
-    if (isinf(minPosTime)) {
+    if (std::isinf(minPosTime)) {
         if (forceVec)
             *forceVec = { 0.0f,0.0f };
         return INFINITY; // No collision in future
     }
     if (earliestTime < 0) { // If also collisions happening in the past, then there must be an intersection (because combined shape is convex)
+        checkCloseCall(-earliestTime - minPosTime, std::max(-earliestTime, minPosTime), closeCall);
         if (-earliestTime < minPosTime) { // If intersection closer to start than finish
             if (forceVec)
                 *forceVec = earliestForceVec;
@@ -454,9 +1107,11 @@ float timeToCollisionCircleLine(const Circle& circle, const Line& line, const fl
 // Takes two circles, and the velocity of the second relative to the first
 // Returns the time that they collide.
 // Returns Inf if there is no collision
-float timeToCollisionCircles(const Circle& a, const Circle& b, const float2& relativeVelocity, float2* const forceVec = nullptr) {
-    float time = pointCircleTimeToCollision(Circle{ b.centre - a.centre ,a.radius + b.radius }, relativeVelocity);
-    if (isnan(time)) {
+template <typename Scalar>
+static Scalar timeToCollisionCircles(const CircleOf<Scalar>& a, const CircleOf<Scalar>& b, const Vector2<Scalar>& relativeVelocity,
+    Vector2<Scalar>* const forceVec, bool& closeCall) {
+    Scalar time = pointCircleTimeToCollision(CircleOf<Scalar>{ b.centre - a.centre ,a.radius + b.radius }, relativeVelocity, closeCall);
+    if (std::isnan(time)) {
         if (forceVec)
             *forceVec = { 0.0f,0.0f };
         return INFINITY; // No collision
@@ -466,7 +1121,8 @@ float timeToCollisionCircles(const Circle& a, const Circle& b, const float2& rel
     if (time >= 0.0f)
         return time;
     // Need to check if objects have intersected slightly, or are just moving apart
-    float timeReverse = pointCircleTimeToCollision(Circle{ b.centre - a.centre ,a.radius + b.radius }, -relativeVelocity);
+    Scalar timeReverse = pointCircleTimeToCollision(CircleOf<Scalar>{ b.centre - a.centre ,a.radius + b.radius }, -relativeVelocity, closeCall);
+    checkCloseCall(timeReverse - time, std::max(std::fabs(timeReverse), std::fabs(time)), closeCall);
     if (timeReverse > time) {
         if (forceVec)
             *forceVec = { 0.0f,0.0f };
@@ -477,102 +1133,1541 @@ float timeToCollisionCircles(const Circle& a, const Circle& b, const float2& rel
     }
 }
 
-void LineAndCircleBoundedCollidable::checkForNextCollision() {
-    // Find when next collision will be, if everything stays on current trajectories
-    
-    // If there is a current possible collision, then the other object needs to have it's pointer made null. This shouldn't be needed?
-    if (nextPossibleCollision) { // If paired with something
-        nextPossibleCollision->nextPossibleCollision = nullptr; // Unpair
-        nextPossibleCollision->forceVec = { 0.0f,0.0f };
+// Works a collision time out in float, or again in double if float was too close to call on something it depended on, such as a
+// grazing contact or lines nearly parallel to the relative velocity. timeToCollision is called with a Scalar of the precision to use
+template <typename Function>
+static float inFloatOrDouble(Function timeToCollision, float2* const forceVec) {
+    bool closeCall = false;
+    float2 floatForceVec = { 0.0f,0.0f };
+    float time = timeToCollision(0.0f, &floatForceVec, closeCall);
+    if (!closeCall) {
+        if (forceVec)
+            *forceVec = floatForceVec;
+        return time;
     }
+    ++precisionFallbacks;
+    Vector2<double> doubleForceVec = { 0.0,0.0 };
+    double doubleTime = timeToCollision(0.0, &doubleForceVec, closeCall);
+    if (forceVec)
+        *forceVec = { static_cast<float>(doubleForceVec.x),static_cast<float>(doubleForceVec.y) };
+    return static_cast<float>(doubleTime);
+}
 
-    float newTimeOfCollision = INFINITY;
-    nextPossibleCollision = nullptr;
-    forceVec = { 0.0f,0.0f };
-    for (auto other : collidables) {
-        // Synchronise objects
-        float2 thisLoc = this->location;
-        float2 otherLoc = other->location;
-        float thisTA = this->timeAhead;
-        float otherTA = other->timeAhead;
-        if (thisTA < otherTA) { // Advance this->location
-            thisLoc += (otherTA - thisTA) * this->velocity;
-            thisTA = otherTA;
-        }
-        else { // Advance other->location
-            otherLoc += (thisTA - otherTA) * other->velocity;
-            otherTA = thisTA; // Not actually used
-        }
-        float2 relativeVelocity = other->velocity - this->velocity;
-
-        float minTime = INFINITY;
-        float2 forceVecTemp;
-        float2 thisCollisionForceVec = { 0.0f,0.0f };
-        for (auto& line : this->lines) {
-            for (auto& line2 : other->lines) {
-                float time = timeToCollisionLines(line + thisLoc, line2 + otherLoc, relativeVelocity, &forceVecTemp);
-                if (time < minTime) {
-                    minTime = time;
-                    thisCollisionForceVec = forceVecTemp;
+static float timeToCollisionLines(const Line& a, const Line& b, const float2& relativeVelocity, float2* const forceVec = nullptr) {
+    return inFloatOrDouble([&](auto scalar, auto* force, bool& closeCall) {
+        if constexpr (std::is_same_v<decltype(scalar), float>)
+            return timeToCollisionLines(a, b, relativeVelocity, force, closeCall);
+        else
+            return timeToCollisionLines(toDouble(a), toDouble(b), toDouble(relativeVelocity), force, closeCall);
+    }, forceVec);
+}
+
+static float timeToCollisionCircleLine(const Circle& circle, const Line& line, const float2& relativeVelocity, float2* const forceVec = nullptr) {
+    return inFloatOrDouble([&](auto scalar, auto* force, bool& closeCall) {
+        if constexpr (std::is_same_v<decltype(scalar), float>)
+            return timeToCollisionCircleLine(circle, line, relativeVelocity, force, closeCall);
+        else
+            return timeToCollisionCircleLine(toDouble(circle), toDouble(line), toDouble(relativeVelocity), force, closeCall);
+    }, forceVec);
+}
+
+static float timeToCollisionCircles(const Circle& a, const Circle& b, const float2& relativeVelocity, float2* const forceVec = nullptr) {
+    return inFloatOrDouble([&](auto scalar, auto* force, bool& closeCall) {
+        if constexpr (std::is_same_v<decltype(scalar), float>)
+            return timeToCollisionCircles(a, b, relativeVelocity, force, closeCall);
+        else
+            return timeToCollisionCircles(toDouble(a), toDouble(b), toDouble(relativeVelocity), force, closeCall);
+    }, forceVec);
+}
+
+namespace NarrowPhase {
+
+    float pointLineTimeToCollision(const float2& p1, const float2& p2, const float2& relativeVelocity, bool& closeCall) {
+        return ::pointLineTimeToCollision(Line{ p1,p2 }, relativeVelocity, closeCall);
+    }
+
+    float pointCircleTimeToCollision(const float2& centre, float radius, const float2& relativeVelocity, bool& closeCall) {
+        return ::pointCircleTimeToCollision(Circle{ centre,radius }, relativeVelocity, closeCall);
+    }
+
+    float timeToCollisionLines(const float2& a1, const float2& a2, const float2& b1, const float2& b2, const float2& relativeVelocity,
+        float2* forceVec) {
+        return ::timeToCollisionLines(Line{ a1,a2 }, Line{ b1,b2 }, relativeVelocity, forceVec);
+    }
+
+    float timeToCollisionCircleLine(const float2& centre, float radius, const float2& p1, const float2& p2, const float2& relativeVelocity,
+        float2* forceVec) {
+        return ::timeToCollisionCircleLine(Circle{ centre,radius }, Line{ p1,p2 }, relativeVelocity, forceVec);
+    }
+
+    float timeToCollisionCircles(const float2& aCentre, float aRadius, const float2& bCentre, float bRadius, const float2& relativeVelocity,
+        float2* forceVec) {
+        return ::timeToCollisionCircles(Circle{ aCentre,aRadius }, Circle{ bCentre,bRadius }, relativeVelocity, forceVec);
+    }
+}
+
+float CollisionWorld::Body::timeToCollisionWith(const Body& other, float2& collisionForceVec, int& collisionCell, float timeLimit) const {
+    // Synchronise objects
+    float2 thisLoc = this->location;
+    float2 otherLoc = other.location;
+    float thisTA = this->timeAhead;
+    float otherTA = other.timeAhead;
+    if (thisTA < otherTA) { // Advance this->location
+        thisLoc += (otherTA - thisTA) * this->velocity;
+        thisTA = otherTA;
+    }
+    else { // Advance other.location
+        otherLoc += (thisTA - otherTA) * other.velocity;
+        otherTA = thisTA; // Not actually used
+    }
+    float2 relativeVelocity = other.velocity - this->velocity;
+
+    return world->timeToCollisionShapes(getShapes(), thisLoc, other.getShapes(), otherLoc, relativeVelocity, timeLimit - thisTA, collisionForceVec,
+        collisionCell) + thisTA;
+}
+
+// Takes two sets of shapes at their locations, and the velocity of b relative to a. Returns the time after now that they collide, and
+// which cell is hit if one of them is a tile grid. Collisions after timeLimit may be missed
+float CollisionWorld::timeToCollisionShapes(const ShapeSet& a, const float2& aLocation, const ShapeSet& b, const float2& bLocation,
+    const float2& relativeVelocity, float timeLimit, float2& collisionForceVec, int& collisionCell) const {
+    collisionCell = -1;
+    if (a.tileGrid != noTileGrid || b.tileGrid != noTileGrid) {
+        collisionForceVec = { 0.0f,0.0f };
+        if (a.tileGrid != noTileGrid && b.tileGrid != noTileGrid)
+            return INFINITY; // Tile grids don't collide with each other
+        if (a.tileGrid != noTileGrid)
+            return timeToCollisionTiles(tileGrids[a.tileGrid], b.lines, b.circles, bLocation - aLocation, relativeVelocity,
+                timeLimit, collisionForceVec, collisionCell);
+        return timeToCollisionTiles(tileGrids[b.tileGrid], a.lines, a.circles, aLocation - bLocation, -relativeVelocity,
+            timeLimit, collisionForceVec, collisionCell);
+    }
+    if (a.staticMesh != noStaticMesh)
+        return timeToCollisionMesh(staticMeshes[a.staticMesh], a.lines, a.circles, b.lines, b.circles, bLocation - aLocation,
+            relativeVelocity, timeLimit, collisionForceVec);
+    if (b.staticMesh != noStaticMesh)
+        return timeToCollisionMesh(staticMeshes[b.staticMesh], b.lines, b.circles, a.lines, a.circles, aLocation - bLocation,
+            -relativeVelocity, timeLimit, collisionForceVec);
+
+    float minTime = INFINITY;
+    float2 forceVecTemp;
+    collisionForceVec = { 0.0f,0.0f };
+    for (auto& line : a.lines) {
+        for (auto& line2 : b.lines) {
+            float time = timeToCollisionLines(line + aLocation, line2 + bLocation, relativeVelocity, &forceVecTemp);
+            if (time < minTime) {
+                minTime = time;
+                collisionForceVec = forceVecTemp;
+            }
+        }
+        for (auto& circle : b.circles) {
+            float time = timeToCollisionCircleLine(circle + bLocation, line + aLocation, -relativeVelocity, &forceVecTemp);
+            if (time < minTime) {
+                minTime = time;
+                collisionForceVec = forceVecTemp;
+            }
+        }
+    }
+    for (auto& circle : a.circles) {
+        for (auto& line : b.lines) {
+            float time = timeToCollisionCircleLine(circle + aLocation, line + bLocation, relativeVelocity, &forceVecTemp);
+            if (time < minTime) {
+                minTime = time;
+                collisionForceVec = forceVecTemp;
+            }
+        }
+        for (auto& circle2 : b.circles) {
+            float time = timeToCollisionCircles(circle + aLocation, circle2 + bLocation, relativeVelocity, &forceVecTemp);
+            if (time < minTime) {
+                minTime = time;
+                collisionForceVec = forceVecTemp;
+            }
+        }
+    }
+    return minTime;
+}
+
+// Takes a tile grid, the lines and circles of another object at offset from the grid's location, and the velocity of that object
+// relative to the grid. Returns the time that they collide, and which cell is hit. Collisions after timeLimit may be missed
+// Circles are only checked against the cells near their path, found by stepping from cell to cell along it (Amanatides and Woo's
+// method), so the cost depends on how far they travel through the grid rather than on how many cells it has. Lines are checked
+// against every solid cell in the box they sweep out before timeLimit
+float CollisionWorld::timeToCollisionTiles(const TileGrid& grid, ShapeRange<Line> lines, ShapeRange<Circle> circles,
+    const float2& offset, const float2& relativeVelocity, float timeLimit, float2& collisionForceVec, int& collisionCell) {
+    float minTime = INFINITY;
+    float2 forceVecTemp;
+    collisionForceVec = { 0.0f,0.0f };
+    collisionCell = -1;
+    if (grid.cells.empty())
+        return minTime;
+
+    // The solid part of a cell, as the lines of a rectangle with its top left corner at the origin
+    float2 size = grid.cellSize * grid.fill;
+    float2 inset = { grid.cellSize.x * (1 - grid.fill) / 2,-grid.cellSize.y * (1 - grid.fill) / 2 };
+    const Line cellLines[4] = { { { 0.0f,0.0f },{ size.x,0.0f } },{ { size.x,0.0f },{ size.x,-size.y } },
+        { { size.x,-size.y },{ 0.0f,-size.y } },{ { 0.0f,-size.y },{ 0.0f,0.0f } } };
+    auto cellCorner = [&](int column, int row) {
+        return grid.topLeft + float2{ column * grid.cellSize.x,-row * grid.cellSize.y } + inset;
+    };
+
+    for (auto& line : lines) {
+        Line movingLine = line + offset;
+        // Only cells that the box around the line passes through before timeLimit are checked, or every cell if there is no limit
+        unsigned int firstColumn = 0;
+        unsigned int lastColumn = grid.columns - 1;
+        unsigned int firstRow = 0;
+        unsigned int lastRow = grid.rows - 1;
+        if (timeLimit < INFINITY) {
+            float2 low = { std::min(movingLine.p1.x, movingLine.p2.x),std::min(movingLine.p1.y, movingLine.p2.y) };
+            float2 high = { std::max(movingLine.p1.x, movingLine.p2.x),std::max(movingLine.p1.y, movingLine.p2.y) };
+            float2 travel = relativeVelocity * std::max(timeLimit, 0.0f);
+            low += float2{ std::min(travel.x, 0.0f),std::min(travel.y, 0.0f) };
+            high += float2{ std::max(travel.x, 0.0f),std::max(travel.y, 0.0f) };
+            // In cells from the top left of the grid, with a cell to spare for rounding
+            float columnLow = floor((low.x - grid.topLeft.x) / grid.cellSize.x) - 1;
+            float columnHigh = floor((high.x - grid.topLeft.x) / grid.cellSize.x) + 1;
+            float rowLow = floor((grid.topLeft.y - high.y) / grid.cellSize.y) - 1;
+            float rowHigh = floor((grid.topLeft.y - low.y) / grid.cellSize.y) + 1;
+            if (columnHigh < 0 || rowHigh < 0 || columnLow >= grid.columns || rowLow >= grid.rows)
+                continue;
+            firstColumn = static_cast<unsigned int>(std::max(columnLow, 0.0f));
+            lastColumn = static_cast<unsigned int>(std::min(columnHigh, grid.columns - 1.0f));
+            firstRow = static_cast<unsigned int>(std::max(rowLow, 0.0f));
+            lastRow = static_cast<unsigned int>(std::min(rowHigh, grid.rows - 1.0f));
+        }
+        for (unsigned int row = firstRow; row <= lastRow; ++row) {
+            for (unsigned int column = firstColumn; column <= lastColumn; ++column) {
+                if (!grid.cells[row * grid.columns + column])
+                    continue;
+                float2 corner = cellCorner(column, row);
+                for (auto& cellLine : cellLines) {
+                    float time = timeToCollisionLines(movingLine, cellLine + corner, -relativeVelocity, &forceVecTemp);
+                    if (time < minTime) {
+                        minTime = time;
+                        collisionForceVec = forceVecTemp;
+                        collisionCell = row * grid.columns + column;
+                    }
                 }
             }
-            for (auto& circle : other->circles) {
-                float time = timeToCollisionCircleLine(circle + otherLoc, line + thisLoc, -relativeVelocity, &forceVecTemp);
-                if (time < minTime) {
-                    minTime = time;
-                    thisCollisionForceVec = forceVecTemp;
+        }
+    }
+
+    for (auto& shape : circles) {
+        Circle circle = shape + offset;
+        auto checkCells = [&](int firstColumn, int lastColumn, int firstRow, int lastRow) {
+            for (int row = std::max(firstRow, 0); row <= std::min(lastRow, static_cast<int>(grid.rows) - 1); ++row) {
+                for (int column = std::max(firstColumn, 0); column <= std::min(lastColumn, static_cast<int>(grid.columns) - 1); ++column) {
+                    if (!grid.cells[row * grid.columns + column])
+                        continue;
+                    float2 corner = cellCorner(column, row);
+                    for (auto& cellLine : cellLines) {
+                        float time = timeToCollisionCircleLine(circle, cellLine + corner, -relativeVelocity, &forceVecTemp);
+                        if (time < minTime) {
+                            minTime = time;
+                            collisionForceVec = forceVecTemp;
+                            collisionCell = row * grid.columns + column;
+                        }
+                    }
                 }
             }
+        };
+
+        // Positions are in cells from the top left of the grid, with rows counting down
+        float2 position = { (circle.centre.x - grid.topLeft.x) / grid.cellSize.x,(grid.topLeft.y - circle.centre.y) / grid.cellSize.y };
+        float2 velocity = { relativeVelocity.x / grid.cellSize.x,-relativeVelocity.y / grid.cellSize.y };
+        if (velocity == float2{ 0.0f,0.0f })
+            continue; // Can't hit anything without moving relative to the grid
+
+        // The circle can touch cells this far from the one its centre is in, so the centre's path is followed through the grid
+        // widened by this much on each side
+        int reachX = static_cast<int>(ceil(circle.radius / grid.cellSize.x));
+        int reachY = static_cast<int>(ceil(circle.radius / grid.cellSize.y));
+        float enterTime = 0.0f;
+        float exitTime = INFINITY;
+        auto clip = [&](float start, float speed, float low, float high) {
+            if (speed == 0) {
+                if (start < low || start >= high)
+                    exitTime = -INFINITY;
+                return;
+            }
+            float lowTime = (low - start) / speed;
+            float highTime = (high - start) / speed;
+            enterTime = std::max(enterTime, std::min(lowTime, highTime));
+            exitTime = std::min(exitTime, std::max(lowTime, highTime));
+        };
+        clip(position.x, velocity.x, static_cast<float>(-reachX), static_cast<float>(grid.columns + reachX));
+        clip(position.y, velocity.y, static_cast<float>(-reachY), static_cast<float>(grid.rows + reachY));
+        if (enterTime >= exitTime || enterTime > std::min(minTime, timeLimit))
+            continue; // Never near the grid, or not soon enough
+
+        float2 start = position + velocity * enterTime;
+        int column = std::clamp(static_cast<int>(floor(start.x)), -reachX, static_cast<int>(grid.columns) + reachX - 1);
+        int row = std::clamp(static_cast<int>(floor(start.y)), -reachY, static_cast<int>(grid.rows) + reachY - 1);
+        int stepX = velocity.x > 0 ? 1 : -1;
+        int stepY = velocity.y > 0 ? 1 : -1;
+        float nextXTime = velocity.x != 0 ? enterTime + (column + (stepX > 0 ? 1 : 0) - start.x) / velocity.x : INFINITY;
+        float nextYTime = velocity.y != 0 ? enterTime + (row + (stepY > 0 ? 1 : 0) - start.y) / velocity.y : INFINITY;
+        float xStepTime = 1 / std::fabs(velocity.x); // Infinite if not moving that way
+        float yStepTime = 1 / std::fabs(velocity.y);
+
+        // Every cell within reach of the first one is checked, then only the ones newly in reach after each step. A cell is always
+        // checked by the time the centre reaches the cell it is in when the circle hits it, so once the centre's next step is after
+        // the soonest hit found, nothing left can be sooner
+        checkCells(column - reachX, column + reachX, row - reachY, row + reachY);
+        while (true) {
+            float nextTime = std::min(nextXTime, nextYTime);
+            if (nextTime >= exitTime || nextTime > minTime || nextTime > timeLimit)
+                break;
+            if (nextXTime < nextYTime) {
+                column += stepX;
+                nextXTime += xStepTime;
+                checkCells(column + stepX * reachX, column + stepX * reachX, row - reachY, row + reachY);
+            }
+            else {
+                row += stepY;
+                nextYTime += yStepTime;
+                checkCells(column - reachX, column + reachX, row + stepY * reachY, row + stepY * reachY);
+            }
         }
-        for (auto& circle : this->circles) {
-            for (auto& line : other->lines) {
-                float time = timeToCollisionCircleLine(circle + thisLoc, line + otherLoc, relativeVelocity, &forceVecTemp);
+    }
+    return minTime;
+}
+
+// Takes a baked mesh and its shapes, the lines and circles of another object at offset from the mesh's location, and the velocity of
+// that object relative to the mesh. Returns the time that they collide. Collisions after timeLimit may be missed
+// Each of the other object's shapes searches the mesh's tree for the boxes its own box passes through, nearest first, and stops once
+// the rest are further away than the soonest collision found
+float CollisionWorld::timeToCollisionMesh(const StaticMesh& mesh, ShapeRange<Line> meshLines, ShapeRange<Circle> meshCircles,
+    ShapeRange<Line> lines, ShapeRange<Circle> circles, const float2& offset, const float2& relativeVelocity, float timeLimit,
+    float2& collisionForceVec) {
+    float minTime = INFINITY;
+    float2 forceVecTemp;
+    collisionForceVec = { 0.0f,0.0f };
+    if (mesh.nodes.empty())
+        return minTime;
+    uint32_t meshLineCount = static_cast<uint32_t>(meshLines.end() - meshLines.begin());
+
+    // When a box from low to high, moving at relativeVelocity, first overlaps a node's box. Infinite if it never does from now on
+    auto timeToOverlap = [&](const MeshNode& node, const float2& low, const float2& high) {
+        float enterTime = -INFINITY;
+        float exitTime = INFINITY;
+        auto clip = [&](float speed, float shapeLow, float shapeHigh, float nodeLow, float nodeHigh) {
+            if (speed == 0) {
+                if (shapeHigh < nodeLow || shapeLow > nodeHigh)
+                    exitTime = -INFINITY;
+                return;
+            }
+            float touchTime = (nodeLow - shapeHigh) / speed;
+            float leaveTime = (nodeHigh - shapeLow) / speed;
+            enterTime = std::max(enterTime, std::min(touchTime, leaveTime));
+            exitTime = std::min(exitTime, std::max(touchTime, leaveTime));
+        };
+        clip(relativeVelocity.x, low.x, high.x, node.low.x, node.high.x);
+        clip(relativeVelocity.y, low.y, high.y, node.low.y, node.high.y);
+        return enterTime <= exitTime && exitTime >= 0 ? enterTime : INFINITY;
+    };
+
+    // testShape is called with the index of each of the mesh's shapes that the box could hit before the soonest collision so far
+    auto search = [&](float2 low, float2 high, auto&& testShape) {
+        low -= float2{ meshBoxMargin,meshBoxMargin };
+        high += float2{ meshBoxMargin,meshBoxMargin };
+        std::pair<float, uint32_t> stack[64]; // Deep enough for any tree, since each node has at least half of its parent's shapes
+        int size = 0;
+        stack[size++] = { timeToOverlap(mesh.nodes[0], low, high),0 };
+        while (size > 0) {
+            auto [time, index] = stack[--size];
+            if (time > minTime || time > timeLimit)
+                continue;
+            const MeshNode& node = mesh.nodes[index];
+            if (node.shapeCount) {
+                for (uint32_t i = node.firstShape; i < node.firstShape + node.shapeCount; ++i)
+                    testShape(mesh.shapes[i]);
+                continue;
+            }
+            // The nearer child goes on top, so it is searched first
+            std::pair<float, uint32_t> first = { timeToOverlap(mesh.nodes[index + 1], low, high),index + 1 };
+            std::pair<float, uint32_t> second = { timeToOverlap(mesh.nodes[node.secondChild], low, high),node.secondChild };
+            if (first.first < second.first)
+                std::swap(first, second);
+            stack[size++] = first;
+            stack[size++] = second;
+        }
+    };
+
+    for (auto& shape : lines) {
+        Line line = shape + offset;
+        search({ std::min(line.p1.x, line.p2.x),std::min(line.p1.y, line.p2.y) }, { std::max(line.p1.x, line.p2.x),std::max(line.p1.y, line.p2.y) },
+            [&](uint32_t meshShape) {
+                float time = meshShape < meshLineCount
+                    ? timeToCollisionLines(meshLines.begin()[meshShape], line, relativeVelocity, &forceVecTemp)
+                    : timeToCollisionCircleLine(meshCircles.begin()[meshShape - meshLineCount], line, relativeVelocity, &forceVecTemp);
                 if (time < minTime) {
                     minTime = time;
-                    thisCollisionForceVec = forceVecTemp;
+                    collisionForceVec = forceVecTemp;
                 }
-            }
-            for (auto& circle2 : other->circles) {
-                float time = timeToCollisionCircles(circle + thisLoc, circle2 + otherLoc, relativeVelocity, &forceVecTemp);
+            });
+    }
+    for (auto& shape : circles) {
+        Circle circle = shape + offset;
+        search(circle.centre - float2{ circle.radius,circle.radius }, circle.centre + float2{ circle.radius,circle.radius },
+            [&](uint32_t meshShape) {
+                float time = meshShape < meshLineCount
+                    ? timeToCollisionCircleLine(circle, meshLines.begin()[meshShape], -relativeVelocity, &forceVecTemp)
+                    : timeToCollisionCircles(meshCircles.begin()[meshShape - meshLineCount], circle, relativeVelocity, &forceVecTemp);
                 if (time < minTime) {
                     minTime = time;
-                    thisCollisionForceVec = forceVecTemp;
+                    collisionForceVec = forceVecTemp;
                 }
-            }
-        }
-        minTime += thisTA;
+            });
+    }
+    return minTime;
+}
+
+float CollisionWorld::Body::timeToReach(const Body& other) const {
+    // Lower bound on the time of collision: the bounding circles have to touch first, and can't close faster than the relative speed
+    float startTime = std::max(timeAhead, other.timeAhead);
+    float2 separation = (other.location + other.velocity * (startTime - other.timeAhead)) - (location + velocity * (startTime - timeAhead));
+    float2 relativeVelocity = other.velocity - velocity;
+    if (relativeVelocity == float2{ 0,0 })
+        return INFINITY; // Can't hit each other, even with overlapping bounds, such as walls next to a tile grid
+    float gap = std::sqrt(dotProduct(separation, separation)) - boundingRadius - other.boundingRadius - 1e-6f; // Allow for rounding
+    if (gap <= 0)
+        return startTime;
+    return startTime + gap / std::sqrt(dotProduct(relativeVelocity, relativeVelocity));
+}
+
+void CollisionWorld::Body::checkForNextCollision() {
+    // Find when next collision will be, if everything stays on current trajectories
+
+    // If there is a current possible collision, then the other object needs to be unpaired. This shouldn't be needed?
+    unpair();
+
+    // Only objects that have been near enough recently are checked. Those lists are only complete until the object has moved
+    // a third of the skin: by then, an object that wasn't near enough could have moved the other two thirds towards it
+    float allowedMovement = world->neighbourSkin / 3;
+    float2 moved = location - neighbourListCentre;
+    if (!neighbourListValid || dotProduct(moved, moved) >= 0.99f * allowedMovement * allowedMovement)
+        rebuildNeighbourList();
+    moved = location - neighbourListCentre;
+    float speed = std::sqrt(dotProduct(velocity, velocity));
+    neighbourListExpiry = speed > 0 ? timeAhead + (allowedMovement - std::sqrt(dotProduct(moved, moved))) / speed : INFINITY;
+
+    // Collisions after the next scheduled velocity change can't be predicted yet, nor ones after the neighbour list expires
+    float newTimeOfCollision = neighbourListExpiry;
+    if (!scheduledVelocities.empty())
+        newTimeOfCollision = std::min(newTimeOfCollision, std::max(scheduledVelocities.front().time, timeAhead));
+    float searchLimit = newTimeOfCollision;
+    // Neighbours are checked in order of the soonest they could possibly be hit, found from the gap between their bounds and how
+    // fast they are closing. Once that is later than the soonest collision found, nothing left can be sooner
+    auto& candidates = world->candidates;
+    auto soonestFirst = [](const std::pair<float, Body*>& a, const std::pair<float, Body*>& b) {
+        return a.first > b.first;
+    };
+    candidates.clear();
+    for (auto handle : neighbours) {
+        Body* other = world->getBody(handle);
+        float earliestTime = timeToReach(*other);
+        if (earliestTime < searchLimit && earliestTime <= other->timeOfCollision)
+            candidates.emplace_back(earliestTime, other);
+    }
+    std::make_heap(candidates.begin(), candidates.end(), soonestFirst);
+
+    auto& nearlySoonest = world->nearlySoonest;
+    nearlySoonest.clear();
+    Body* soonest = nullptr;
+    int soonestCell = -1;
+    while (!candidates.empty() && candidates.front().first <= newTimeOfCollision + simultaneousCollisionTime) {
+        Body* other = candidates.front().second;
+        std::pop_heap(candidates.begin(), candidates.end(), soonestFirst);
+        candidates.pop_back();
+
+        float2 thisCollisionForceVec;
+        int thisCollisionCell;
+        float timeLimit = std::min({ searchLimit,newTimeOfCollision + simultaneousCollisionTime,other->timeOfCollision });
+        ++world->statistics.pairTests;
+        float minTime = timeToCollisionWith(*other, thisCollisionForceVec, thisCollisionCell, timeLimit);
+        if (minTime < other->timeOfCollision && minTime < searchLimit && minTime <= newTimeOfCollision + simultaneousCollisionTime)
+            nearlySoonest.emplace_back(minTime, other);
         if (minTime < newTimeOfCollision && minTime < other->timeOfCollision) {
             newTimeOfCollision = minTime;
-            nextPossibleCollision = other;
+            soonest = other;
+            soonestCell = thisCollisionCell;
             forceVec = thisCollisionForceVec;
         }
     }
+    ++world->statistics.scans;
+
+    // Keep track of other collisions at almost the same time, so that they can be resolved together
+    simultaneousCollisions.clear();
+    for (auto& [time, other] : nearlySoonest) {
+        if (other != soonest && time <= newTimeOfCollision + simultaneousCollisionTime)
+            simultaneousCollisions.push_back(other->getHandle());
+    }
 
     // Move to new position in list
     updateListPosition(newTimeOfCollision);
-    if (nextPossibleCollision) {
-        if (nextPossibleCollision->nextPossibleCollision) // If it is paired
-        {
-            nextPossibleCollision->nextPossibleCollision->nextPossibleCollision = nullptr; // Unpair
-            nextPossibleCollision->nextPossibleCollision->forceVec = { 0.0f,0.0f };
+    if (soonest) {
+        soonest->unpair(); // If it is paired with something else
+        nextPossibleCollision = soonest->getHandle();
+        contactCell = soonestCell;
+        soonest->nextPossibleCollision = getHandle();
+        soonest->forceVec = forceVec;
+        soonest->contactCell = soonestCell;
+        soonest->updateListPosition(newTimeOfCollision);
+    }
+}
+
+void LineAndCircleBoundedCollidable::predictContacts(float horizon, unsigned int maxContacts, std::vector<PredictedContact>& contacts) const {
+    predictContacts(body().location, body().velocity, horizon, maxContacts, contacts);
+}
+
+void LineAndCircleBoundedCollidable::predictContacts(const float2& location, const float2& velocity, float horizon, unsigned int maxContacts,
+    std::vector<PredictedContact>& contacts) const {
+    contacts.clear();
+    const Body& actual = body();
+
+    // A stand-in with the object's shapes is moved along the predicted path, so that nothing real changes
+    Body probe{ world };
+    probe.location = location;
+    probe.velocity = velocity;
+    probe.timeAhead = actual.timeAhead;
+    probe.firstLine = actual.firstLine;
+    probe.lineCount = actual.lineCount;
+    probe.firstCircle = actual.firstCircle;
+    probe.circleCount = actual.circleCount;
+    probe.tileGrid = actual.tileGrid;
+    probe.staticMesh = actual.staticMesh;
+    probe.boundingRadius = actual.boundingRadius;
+
+    // Everything is assumed to carry on in a straight line, so only objects in the grid cells near the stand-in's path can be hit. The
+    // path is widened by how far anything could move between the start of the tick and the horizon
+    world->updateSpatialGrid();
+    const CollisionWorld::SpatialGrid& grid = world->spatialGrid;
+    auto distanceBy = [](float speed, float time) { return speed == 0 ? 0.0f : speed * time; }; // Not NaN for an infinite horizon
+    while (contacts.size() < maxContacts && probe.timeAhead < horizon) {
+        float2 pathEnd = { probe.location.x + distanceBy(probe.velocity.x, horizon - probe.timeAhead),
+            probe.location.y + distanceBy(probe.velocity.y, horizon - probe.timeAhead) };
+        float margin = probe.boundingRadius + distanceBy(grid.fastestSpeed * 1.001f, std::max(horizon, 0.0f));
+        float2 pathLow = { std::min(probe.location.x, pathEnd.x) - margin,std::min(probe.location.y, pathEnd.y) - margin };
+        float2 pathHigh = { std::max(probe.location.x, pathEnd.x) + margin,std::max(probe.location.y, pathEnd.y) + margin };
+
+        // Ties go to the object earliest in the table, so that the answer doesn't depend on the order the grid gives them in
+        float soonestTime = horizon;
+        const Body* soonest = nullptr;
+        float2 forceVec = { 0.0f,0.0f };
+        int cell = -1;
+        world->forEachIndexInBox(pathLow, pathHigh, [&](uint32_t index) {
+            const Body& other = world->bodies[index];
+            if (&other == &actual || probe.timeToReach(other) > soonestTime)
+                return;
+            float2 thisForceVec;
+            int thisCell;
+            float time = probe.timeToCollisionWith(other, thisForceVec, thisCell, soonestTime);
+            if (time < soonestTime || (time == soonestTime && time < horizon && &other < soonest)) {
+                soonestTime = time;
+                soonest = &other;
+                forceVec = thisForceVec;
+                cell = thisCell;
+            }
+        });
+        if (!soonest || dotProduct(forceVec, forceVec) == 0)
+            break;
+
+        probe.location += probe.velocity * (soonestTime - probe.timeAhead);
+        probe.timeAhead = soonestTime;
+
+        // Bounce as resolveContacts would for this contact on its own, keeping only the object's new velocity
+        float2 otherVelocity = soonest->velocity;
+        if (dotProduct(probe.velocity - otherVelocity, forceVec) > 0)
+            forceVec = -forceVec;
+        Matrix2x2 inverseMass = actual.owner->getInverseMassMatrix();
+        Matrix2x2 otherInverseMass = soonest->owner->getInverseMassMatrix();
+        float X = bounceImpulse(probe.velocity, otherVelocity, forceVec, inverseMass, otherInverseMass, actual.owner->getCorFactorPerp(),
+            soonest->owner->getCorFactorPerp(), false);
+        if (!std::isnormal(X) || X < 0)
+            break; // Can't be bounced, e.g. both objects are immovable
+        probe.velocity += inverseMass * (X * forceVec);
+        otherVelocity -= otherInverseMass * (X * forceVec);
+        applyFriction(probe.velocity, otherVelocity, forceVec, inverseMass, otherInverseMass,
+            1.0f - actual.owner->getCorFactorTang() * soonest->owner->getCorFactorTang());
+
+        contacts.push_back(PredictedContact{ soonestTime,soonest->getHandle(),probe.location,probe.velocity,normalise(forceVec),cell });
+    }
+}
+
+void CollisionWorld::Body::rebuildNeighbourList() {
+    ++world->statistics.neighbourListRebuilds;
+    removeFromNeighbourLists();
+    BodyHandle thisHandle = getHandle();
+    // Only objects in the grid cells near enough can be near enough. They are gone through in the same order as the collision list,
+    // which is what a tie between collisions is settled by, so that the grid's layout never changes what happens
+    auto& found = world->neighbourCandidates;
+    found.clear();
+    float2 searchRadius = { boundingRadius + world->neighbourSkin,boundingRadius + world->neighbourSkin };
+    world->forEachIndexInBox(location - searchRadius, location + searchRadius, [&](uint32_t index) { found.push_back(index); });
+    std::sort(found.begin(), found.end(), world->collidables.key_comp());
+    for (auto index : found) {
+        Body& other = world->bodies[index];
+        if (&other == this)
+            continue;
+        float2 otherLoc = other.location + other.velocity * (timeAhead - other.timeAhead);
+        float2 separation = otherLoc - location;
+        float reach = boundingRadius + other.boundingRadius + world->neighbourSkin;
+        if (dotProduct(separation, separation) <= reach * reach) {
+            neighbours.push_back(other.getHandle());
+            other.neighbours.push_back(thisHandle);
+        }
+    }
+    neighbourListCentre = location;
+    neighbourListValid = true;
+    world->moveInGrid(getIndex());
+}
+
+void CollisionWorld::Body::removeFromNeighbourLists() {
+    BodyHandle thisHandle = getHandle();
+    for (auto handle : neighbours) {
+        auto& list = world->getBody(handle)->neighbours;
+        auto it = std::find(list.begin(), list.end(), thisHandle);
+        *it = list.back();
+        list.pop_back();
+    }
+    neighbours.clear();
+}
+
+void CollisionWorld::setNeighbourSkin(float skin) {
+    // Lists made with the old skin may not be complete for the new one, so everything is checked again. The grid allows for how far
+    // objects get from their lists' centres, which depends on the skin too
+    neighbourSkin = skin;
+    spatialGrid.valid = false;
+    for (auto index : collidables)
+        bodies[index].neighbourListValid = false;
+    std::vector<uint32_t> all{ collidables.begin(),collidables.end() };
+    for (auto index : all)
+        bodies[index].changeTrajectory(bodies[index].location, bodies[index].velocity);
+}
+
+ShapeRange<Line> CollisionWorld::Body::getLines() const {
+    return { world->lineStore.data() + firstLine,world->lineStore.data() + firstLine + lineCount };
+}
+
+ShapeRange<Circle> CollisionWorld::Body::getCircles() const {
+    return { world->circleStore.data() + firstCircle,world->circleStore.data() + firstCircle + circleCount };
+}
+
+CollisionWorld::ShapeSet CollisionWorld::Body::getShapes() const {
+    return { getLines(),getCircles(),tileGrid,staticMesh };
+}
+
+// Spreads the lower 16 bits of x out to the even bits of the result
+static uint32_t spreadBits(uint32_t x) {
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+void CollisionWorld::sortStorageSpatially() {
+    if (collidables.empty())
+        return;
+
+    // Order objects along a Z-order (Morton) curve through their locations, which keeps nearby objects mostly close together
+    float2 low = bodies[*collidables.begin()].location;
+    float2 high = low;
+    for (auto index : collidables) {
+        Body& body = bodies[index];
+        low = { std::min(low.x, body.location.x),std::min(low.y, body.location.y) };
+        high = { std::max(high.x, body.location.x),std::max(high.y, body.location.y) };
+    }
+    float2 scale = { 65535.0f / std::max(high.x - low.x, 1e-6f),65535.0f / std::max(high.y - low.y, 1e-6f) };
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> order{ &heap }; // Code and index, so that ties always come out the same way
+    order.reserve(collidables.size());
+    for (auto index : collidables) {
+        Body& body = bodies[index];
+        uint32_t x = static_cast<uint32_t>((body.location.x - low.x) * scale.x);
+        uint32_t y = static_cast<uint32_t>((body.location.y - low.y) * scale.y);
+        order.emplace_back(spreadBits(x) | (spreadBits(y) << 1), index);
+    }
+    std::sort(order.begin(), order.end());
+
+    // The objects take the first slots in that order, each with a new generation for its slot. Every handle in the world is changed to
+    // match while the old table is still there to look them up in. Handles to destroyed objects are dropped
+    uint32_t slotCount = static_cast<uint32_t>(bodies.size());
+    uint32_t usedCount = static_cast<uint32_t>(order.size());
+    std::pmr::vector<uint32_t> newIndex(slotCount, noBody, &heap);
+    for (uint32_t slot = 0; slot < usedCount; ++slot)
+        newIndex[order[slot].second] = slot;
+    std::pmr::vector<uint32_t> generations{ &heap };
+    generations.reserve(slotCount);
+    for (auto& body : bodies)
+        generations.push_back(body.generation);
+    auto newGeneration = [&](uint32_t slot) { return generations[slot] % maxGeneration + 1; };
+    auto newHandle = [&](BodyHandle handle) {
+        Body* body = getBody(handle);
+        if (!body)
+            return BodyHandle{};
+        uint32_t slot = newIndex[body->getIndex()];
+        return BodyHandle{ newGeneration(slot) << slotIndexBits | slot };
+    };
+    for (auto [code, index] : order) {
+        Body& body = bodies[index];
+        body.nextPossibleCollision = newHandle(body.nextPossibleCollision);
+        for (auto& handle : body.simultaneousCollisions)
+            handle = newHandle(handle);
+        for (auto& handle : body.neighbours)
+            handle = newHandle(handle);
+        body.owner->handle = newHandle(body.getHandle());
+    }
+    for (auto& event : collisionEvents) {
+        event.a = newHandle(event.a);
+        event.b = newHandle(event.b);
+    }
+
+    // Free slots go after the objects, keeping the generations of the slots they go in, with the first of them to be used next
+    std::pmr::vector<Body> newBodies{ &heap };
+    newBodies.reserve(slotCount);
+    for (uint32_t slot = 0; slot < usedCount; ++slot) {
+        newBodies.push_back(std::move(bodies[order[slot].second]));
+        newBodies.back().generation = newGeneration(slot);
+    }
+    for (uint32_t index = 0; index < slotCount; ++index) {
+        if (newIndex[index] == noBody) {
+            newBodies.push_back(std::move(bodies[index]));
+            newBodies.back().generation = generations[newBodies.size() - 1];
+        }
+    }
+    bodies.swap(newBodies);
+    collidables.clear();
+    freeSlots.clear();
+    for (uint32_t slot = 0; slot < usedCount; ++slot)
+        collidables.insert(slot);
+    for (uint32_t slot = slotCount; slot-- > usedCount;)
+        freeSlots.push_back(slot);
+    spatialGrid.valid = false;
+
+    // Copy everything into new stores in the same order, leaving out any gaps
+    std::pmr::vector<Line> newLineStore{ &pool };
+    std::pmr::vector<Circle> newCircleStore{ &pool };
+    newLineStore.reserve(lineStore.size());
+    newCircleStore.reserve(circleStore.size());
+    for (uint32_t slot = 0; slot < usedCount; ++slot) {
+        Body& body = bodies[slot];
+        unsigned int newFirstLine = static_cast<unsigned int>(newLineStore.size());
+        newLineStore.insert(newLineStore.end(), lineStore.begin() + body.firstLine, lineStore.begin() + body.firstLine + body.lineCount);
+        body.firstLine = newFirstLine;
+        unsigned int newFirstCircle = static_cast<unsigned int>(newCircleStore.size());
+        newCircleStore.insert(newCircleStore.end(), circleStore.begin() + body.firstCircle, circleStore.begin() + body.firstCircle + body.circleCount);
+        body.firstCircle = newFirstCircle;
+    }
+    lineStore.swap(newLineStore);
+    circleStore.swap(newCircleStore);
+    unusedShapes = 0;
+}
+
+// Appends values to a snapshot as their bytes in memory, so snapshots only go between builds for the same kind of machine. Only numbers
+// are written, with structs gone through a field at a time by transferState, so that the padding between fields never ends up in a snapshot
+class SnapshotWriter {
+    std::vector<unsigned char>& blob;
+public:
+    explicit SnapshotWriter(std::vector<unsigned char>& blob) : blob{ blob } {}
+    bool changesWorld() const { return false; }
+    // For how many of something follow, which has to be known even when only checking
+    uint32_t count(uint32_t current) {
+        value(current);
+        return current;
+    }
+    template <typename T>
+    void value(const T& value) {
+        static_assert(std::is_arithmetic_v<T>);
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+        blob.insert(blob.end(), bytes, bytes + sizeof(T));
+    }
+    template <typename Vector>
+    void vector(const Vector& values) {
+        static_assert(std::is_arithmetic_v<typename Vector::value_type>);
+        value(static_cast<uint32_t>(values.size()));
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values.data());
+        blob.insert(blob.end(), bytes, bytes + values.size() * sizeof(typename Vector::value_type));
+    }
+    // For vectors of structs, with 'element' going through the fields of each
+    template <typename Vector, typename Element>
+    void vector(Vector& values, Element element) {
+        value(static_cast<uint32_t>(values.size()));
+        for (auto& entry : values)
+            element(entry);
+    }
+};
+
+// Reads back what SnapshotWriter wrote, in the same order. Unless 'apply' is set, it only checks that everything is there
+class SnapshotReader {
+    std::span<const unsigned char> blob;
+    size_t offset;
+    bool apply;
+
+    const unsigned char* take(size_t bytes) {
+        if (bytes > blob.size() - offset)
+            throw "Snapshot is cut short";
+        const unsigned char* start = blob.data() + offset;
+        offset += bytes;
+        return start;
+    }
+public:
+    SnapshotReader(std::span<const unsigned char> blob, bool apply) : blob{ blob }, offset{ 0 }, apply{ apply } {}
+    bool changesWorld() const { return apply; }
+    uint32_t count(uint32_t) { return read<uint32_t>(); }
+    template <typename T>
+    T read() {
+        static_assert(std::is_arithmetic_v<T>);
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    template <typename T>
+    void value(T& value) {
+        static_assert(std::is_arithmetic_v<T>);
+        const unsigned char* bytes = take(sizeof(T));
+        if (apply)
+            std::memcpy(&value, bytes, sizeof(T));
+    }
+    template <typename Vector>
+    void vector(Vector& values) {
+        static_assert(std::is_arithmetic_v<typename Vector::value_type>);
+        size_t size = read<uint32_t>();
+        const unsigned char* bytes = take(size * sizeof(typename Vector::value_type));
+        if (apply) {
+            values.resize(size);
+            if (size > 0) // data() may be null otherwise
+                std::memcpy(values.data(), bytes, size * sizeof(typename Vector::value_type));
+        }
+    }
+    template <typename Vector, typename Element>
+    void vector(Vector& values, Element element) {
+        size_t size = read<uint32_t>();
+        if (apply) {
+            values.resize(size);
+            for (auto& entry : values)
+                element(entry);
+        }
+        else {
+            // Each field is still read, so that a snapshot that is cut short is found
+            typename Vector::value_type spare{};
+            for (size_t i = 0; i < size; ++i)
+                element(spare);
+        }
+    }
+    bool atEnd() const { return offset == blob.size(); }
+};
+
+// Everything saved after the slot table, in order. The objects in the slots must already match. Statistics are left out, as they count
+// the work done rather than being part of the state
+template <typename Archive>
+void CollisionWorld::transferState(Archive& archive) {
+    auto point = [&](float2& value) {
+        archive.value(value.x);
+        archive.value(value.y);
+    };
+    auto handle = [&](BodyHandle& value) { archive.value(value.id); };
+
+    archive.vector(freeSlots);
+    archive.value(elapsed);
+    archive.value(maxEventsPerTick);
+    archive.value(neighbourSkin);
+    archive.value(recordingCollisionEvents);
+
+    for (auto& body : bodies) {
+        if (!body.owner)
+            continue;
+        point(body.location);
+        point(body.velocity);
+        archive.value(body.timeOfCollision);
+        archive.value(body.timeAhead);
+        handle(body.nextPossibleCollision);
+        archive.value(body.firstLine);
+        archive.value(body.lineCount);
+        archive.value(body.firstCircle);
+        archive.value(body.circleCount);
+        point(body.forceVec);
+        archive.value(body.contactCell);
+        archive.value(body.tileGrid);
+        archive.value(body.staticMesh);
+        archive.vector(body.scheduledVelocities, [&](ScheduledVelocity& scheduled) {
+            archive.value(scheduled.time);
+            point(scheduled.velocity);
+        });
+        archive.value(body.lastCollisionTime);
+        archive.value(body.repeatedCollisions);
+        archive.vector(body.simultaneousCollisions, handle);
+        archive.value(body.boundingRadius);
+        archive.vector(body.neighbours, handle); // In order, as it decides which of two equally soon collisions is found first
+        point(body.neighbourListCentre);
+        archive.value(body.neighbourListExpiry);
+        archive.value(body.neighbourListValid);
+    }
+
+    archive.vector(lineStore, [&](Line& line) {
+        point(line.p1);
+        point(line.p2);
+    });
+    archive.vector(circleStore, [&](Circle& circle) {
+        point(circle.centre);
+        archive.value(circle.radius);
+    });
+    uint64_t gaps = unusedShapes;
+    archive.value(gaps);
+    unusedShapes = static_cast<size_t>(gaps);
+
+    uint32_t tileGridCount = archive.count(static_cast<uint32_t>(tileGrids.size()));
+    if (archive.changesWorld()) {
+        while (tileGrids.size() < tileGridCount)
+            tileGrids.emplace_back(&pool);
+        tileGrids.erase(tileGrids.begin() + tileGridCount, tileGrids.end());
+    }
+    for (uint32_t i = 0; i < tileGridCount; ++i) {
+        TileGrid spare{ &heap }; // Stands in for grids the world doesn't have yet while only checking
+        TileGrid& grid = i < tileGrids.size() ? tileGrids[i] : spare;
+        point(grid.topLeft);
+        point(grid.cellSize);
+        archive.value(grid.fill);
+        archive.value(grid.columns);
+        archive.value(grid.rows);
+        archive.vector(grid.cells);
+    }
+    archive.vector(freeTileGrids);
+    uint32_t staticMeshCount = archive.count(static_cast<uint32_t>(staticMeshes.size()));
+    if (archive.changesWorld()) {
+        while (staticMeshes.size() < staticMeshCount)
+            staticMeshes.emplace_back(&pool);
+        staticMeshes.erase(staticMeshes.begin() + staticMeshCount, staticMeshes.end());
+    }
+    for (uint32_t i = 0; i < staticMeshCount; ++i) {
+        StaticMesh spare{ &heap };
+        StaticMesh& mesh = i < staticMeshes.size() ? staticMeshes[i] : spare;
+        archive.vector(mesh.nodes, [&](MeshNode& node) {
+            point(node.low);
+            point(node.high);
+            archive.value(node.firstShape);
+            archive.value(node.shapeCount);
+            archive.value(node.secondChild);
+        });
+        archive.vector(mesh.shapes);
+    }
+    archive.vector(freeStaticMeshes);
+}
+
+void CollisionWorld::snapshot(std::vector<unsigned char>& blob) const {
+    blob.clear();
+    SnapshotWriter writer{ blob };
+    writer.value(snapshotMagic);
+    writer.value(snapshotVersion);
+
+    // Which slots are in use comes first, so that restore can check the objects match before changing anything
+    writer.value(static_cast<uint32_t>(bodies.size()));
+    for (auto& body : bodies) {
+        writer.value(body.generation);
+        writer.value(static_cast<unsigned char>(body.owner != nullptr));
+    }
+    // Writing only reads from the world, but shares its code with restoring
+    const_cast<CollisionWorld*>(this)->transferState(writer);
+    // The queue isn't saved, as its order comes from the collision times and slot indices
+}
+
+void CollisionWorld::restore(std::span<const unsigned char> blob) {
+    SnapshotReader check{ blob, false };
+    if (check.read<uint32_t>() != snapshotMagic)
+        throw "Not a collision world snapshot";
+    if (check.read<uint32_t>() != snapshotVersion)
+        throw "Snapshot is from a different version";
+    uint32_t slotCount = check.read<uint32_t>();
+    for (uint32_t i = 0; i < std::max(slotCount, static_cast<uint32_t>(bodies.size())); ++i) {
+        uint32_t generation = 0;
+        bool inUse = false;
+        if (i < slotCount) {
+            generation = check.read<uint32_t>();
+            inUse = check.read<unsigned char>() != 0;
+        }
+        bool inUseNow = i < bodies.size() && bodies[i].owner;
+        if (inUse != inUseNow || (inUse && generation != bodies[i].generation))
+            throw "Snapshot is of different objects to the ones in the world";
+    }
+    // Goes through the rest without keeping it first, so that a bad blob is found before anything has changed
+    transferState(check);
+    if (!check.atEnd())
+        throw "Snapshot has something extra at the end";
+
+    // Taken out of the queue while their times are changed, then put back in the order they were in
+    collidables.clear();
+    SnapshotReader reader{ blob, true };
+    reader.read<uint32_t>();
+    reader.read<uint32_t>();
+    reader.read<uint32_t>();
+    while (bodies.size() < slotCount)
+        bodies.emplace_back(this).owner = nullptr;
+    bodies.erase(bodies.begin() + slotCount, bodies.end()); // Only free slots are dropped
+    for (auto& body : bodies) {
+        body.generation = reader.read<uint32_t>();
+        reader.read<unsigned char>();
+    }
+    transferState(reader);
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        if (bodies[i].owner)
+            collidables.insert(i);
+    }
+    collisionEvents.clear();
+    spatialGrid.valid = false;
+}
+
+size_t CollisionWorld::TickState::size() const {
+    auto bytes = [](const auto& values) { return values.size() * sizeof(values[0]); };
+    return sizeof(elapsed) + bytes(slots) + bytes(generations) + bytes(locations) + bytes(velocities) + bytes(timesOfCollision)
+        + bytes(timesAhead) + bytes(nextPossibleCollisions) + bytes(forceVecs) + bytes(contactCells) + bytes(lastCollisionTimes)
+        + bytes(repeatedCollisions) + bytes(neighbourListCentres) + bytes(neighbourListExpiries) + bytes(neighbourListValid)
+        + bytes(scheduledEnds) + bytes(scheduledVelocities) + bytes(simultaneousEnds) + bytes(simultaneousCollisions) + bytes(neighbourEnds)
+        + bytes(neighbours) + bytes(cells);
+}
+
+void CollisionWorld::saveTickState(TickState& state) const {
+    state.elapsed = elapsed;
+    state.slots.clear();
+    state.generations.clear();
+    state.locations.clear();
+    state.velocities.clear();
+    state.timesOfCollision.clear();
+    state.timesAhead.clear();
+    state.nextPossibleCollisions.clear();
+    state.forceVecs.clear();
+    state.contactCells.clear();
+    state.lastCollisionTimes.clear();
+    state.repeatedCollisions.clear();
+    state.neighbourListCentres.clear();
+    state.neighbourListExpiries.clear();
+    state.neighbourListValid.clear();
+    state.scheduledEnds.clear();
+    state.scheduledVelocities.clear();
+    state.simultaneousEnds.clear();
+    state.simultaneousCollisions.clear();
+    state.neighbourEnds.clear();
+    state.neighbours.clear();
+    state.cells.clear();
+
+    // In the queue's order, so that restoring can put each straight on the end
+    for (auto index : collidables) {
+        const Body& body = bodies[index];
+        state.slots.push_back(index);
+        state.generations.push_back(body.generation);
+        state.locations.push_back(body.location);
+        state.velocities.push_back(body.velocity);
+        state.timesOfCollision.push_back(body.timeOfCollision);
+        state.timesAhead.push_back(body.timeAhead);
+        state.nextPossibleCollisions.push_back(body.nextPossibleCollision);
+        state.forceVecs.push_back(body.forceVec);
+        state.contactCells.push_back(body.contactCell);
+        state.lastCollisionTimes.push_back(body.lastCollisionTime);
+        state.repeatedCollisions.push_back(body.repeatedCollisions);
+        state.neighbourListCentres.push_back(body.neighbourListCentre);
+        state.neighbourListExpiries.push_back(body.neighbourListExpiry);
+        state.neighbourListValid.push_back(body.neighbourListValid);
+        state.scheduledVelocities.insert(state.scheduledVelocities.end(), body.scheduledVelocities.begin(), body.scheduledVelocities.end());
+        state.scheduledEnds.push_back(static_cast<uint32_t>(state.scheduledVelocities.size()));
+        state.simultaneousCollisions.insert(state.simultaneousCollisions.end(), body.simultaneousCollisions.begin(), body.simultaneousCollisions.end());
+        state.simultaneousEnds.push_back(static_cast<uint32_t>(state.simultaneousCollisions.size()));
+        state.neighbours.insert(state.neighbours.end(), body.neighbours.begin(), body.neighbours.end());
+        state.neighbourEnds.push_back(static_cast<uint32_t>(state.neighbours.size()));
+    }
+    for (auto& grid : tileGrids)
+        state.cells.insert(state.cells.end(), grid.cells.begin(), grid.cells.end());
+}
+
+void CollisionWorld::restoreTickState(const TickState& state) {
+    size_t cellCount = 0;
+    for (auto& grid : tileGrids)
+        cellCount += grid.cells.size();
+    if (state.slots.size() != collidables.size() || state.cells.size() != cellCount)
+        throw "Tick state is of different objects to the ones in the world";
+    for (size_t i = 0; i < state.slots.size(); ++i) {
+        uint32_t index = state.slots[i];
+        if (index >= bodies.size() || !bodies[index].owner || bodies[index].generation != state.generations[i])
+            throw "Tick state is of different objects to the ones in the world";
+    }
+
+    // Taken out of the queue while their times are changed, then put back in the order they were in
+    collidables.clear();
+    elapsed = state.elapsed;
+    for (size_t i = 0; i < state.slots.size(); ++i) {
+        uint32_t index = state.slots[i];
+        Body& body = bodies[index];
+        body.location = state.locations[i];
+        body.velocity = state.velocities[i];
+        body.timeOfCollision = state.timesOfCollision[i];
+        body.timeAhead = state.timesAhead[i];
+        body.nextPossibleCollision = state.nextPossibleCollisions[i];
+        body.forceVec = state.forceVecs[i];
+        body.contactCell = state.contactCells[i];
+        body.lastCollisionTime = state.lastCollisionTimes[i];
+        body.repeatedCollisions = state.repeatedCollisions[i];
+        body.neighbourListCentre = state.neighbourListCentres[i];
+        body.neighbourListExpiry = state.neighbourListExpiries[i];
+        body.neighbourListValid = state.neighbourListValid[i] != 0;
+        // Assigning keeps the lists' memory, so nothing is allocated unless a list was shorter then
+        uint32_t start = i > 0 ? state.scheduledEnds[i - 1] : 0;
+        body.scheduledVelocities.assign(state.scheduledVelocities.begin() + start, state.scheduledVelocities.begin() + state.scheduledEnds[i]);
+        start = i > 0 ? state.simultaneousEnds[i - 1] : 0;
+        body.simultaneousCollisions.assign(state.simultaneousCollisions.begin() + start,
+            state.simultaneousCollisions.begin() + state.simultaneousEnds[i]);
+        start = i > 0 ? state.neighbourEnds[i - 1] : 0;
+        body.neighbours.assign(state.neighbours.begin() + start, state.neighbours.begin() + state.neighbourEnds[i]);
+        // The grid's cells and speeds are kept, as the shapes are the same
+        moveInGrid(index);
+        spatialGrid.noteVelocity(body.velocity);
+        collidables.insert(collidables.end(), index);
+    }
+    auto cell = state.cells.begin();
+    for (auto& grid : tileGrids) {
+        std::copy(cell, cell + grid.cells.size(), grid.cells.begin());
+        cell += grid.cells.size();
+    }
+    collisionEvents.clear();
+}
+
+// Goes through the shapes in every leaf whose box nodeFilter accepts, giving function their indices in StaticMesh::shapes' numbering
+template <typename NodeFilter, typename Function>
+void CollisionWorld::forEachMeshShape(const StaticMesh& mesh, NodeFilter nodeFilter, Function function) {
+    if (mesh.nodes.empty())
+        return;
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        uint32_t index = stack[--stackSize];
+        const MeshNode& node = mesh.nodes[index];
+        if (!nodeFilter(node.low, node.high))
+            continue;
+        if (node.shapeCount > 0) {
+            for (uint32_t i = 0; i < node.shapeCount; ++i)
+                function(mesh.shapes[node.firstShape + i]);
+            continue;
+        }
+        stack[stackSize++] = node.secondChild;
+        stack[stackSize++] = index + 1;
+    }
+}
+
+void CollisionWorld::SpatialGrid::cellRange(const float2& boxLow, const float2& boxHigh, int& firstColumn, int& lastColumn,
+    int& firstRow, int& lastRow) const {
+    // Worked out in float first, as the box can be far outside the grid or infinite
+    auto toCell = [this](float position, unsigned int count) {
+        float cell = position / cellSize;
+        return cell < 0 ? 0 : cell >= count ? static_cast<int>(count) - 1 : static_cast<int>(cell);
+    };
+    firstColumn = toCell(boxLow.x - low.x, columns);
+    lastColumn = toCell(boxHigh.x - low.x, columns);
+    firstRow = toCell(boxLow.y - low.y, rows);
+    lastRow = toCell(boxHigh.y - low.y, rows);
+}
+
+uint32_t CollisionWorld::SpatialGrid::cellAt(const float2& point) const {
+    int firstColumn, lastColumn, firstRow, lastRow;
+    cellRange(point, point, firstColumn, lastColumn, firstRow, lastRow);
+    return firstRow * columns + firstColumn;
+}
+
+void CollisionWorld::updateSpatialGrid() const {
+    SpatialGrid& grid = spatialGrid;
+    if (grid.valid)
+        return;
+    grid.valid = true;
+    grid.columns = 0;
+    grid.rows = 0;
+    grid.reach = 0.0f;
+    grid.fastestSpeed = 0.0f;
+    grid.cellFirst.clear();
+    grid.bodyCell.assign(bodies.size(), noCell);
+    grid.bodyNext.assign(bodies.size(), noBody);
+    grid.largeBodies.clear();
+
+    // Cells are a few times the size of a typical object, and objects spanning more than a few cells are kept apart
+    grid.radii.clear();
+    for (auto index : collidables) {
+        if (bodies[index].boundingRadius > 0)
+            grid.radii.push_back(bodies[index].boundingRadius);
+        grid.noteVelocity(bodies[index].velocity);
+    }
+    if (grid.radii.empty())
+        return;
+    std::nth_element(grid.radii.begin(), grid.radii.begin() + grid.radii.size() / 2, grid.radii.end());
+    grid.cellSize = 4 * grid.radii[grid.radii.size() / 2];
+    grid.largeRadius = 2 * grid.cellSize;
+
+    // An object gets up to a third of the skin from its neighbour list centre before the list is rebuilt. A little more is allowed
+    // for, as objects can be a little late being checked when their collisions are resolved together with others'
+    float margin = neighbourSkin / 2;
+    float2 low = { INFINITY,INFINITY };
+    float2 high = { -INFINITY,-INFINITY };
+    size_t smallBodies = 0;
+    for (auto index : collidables) {
+        const Body& body = bodies[index];
+        if (body.boundingRadius > grid.largeRadius) {
+            grid.largeBodies.push_back(index);
+        }
+        else if (body.boundingRadius > 0) {
+            low = { std::min(low.x, body.neighbourListCentre.x),std::min(low.y, body.neighbourListCentre.y) };
+            high = { std::max(high.x, body.neighbourListCentre.x),std::max(high.y, body.neighbourListCentre.y) };
+            grid.reach = std::max(grid.reach, body.boundingRadius + margin);
+            ++smallBodies;
+        }
+    }
+    if (smallBodies == 0)
+        return;
+
+    // Objects spread far apart would need a lot of cells, so the cells are made bigger until there are only a few for each object
+    float2 size = high - low;
+    while ((size.x / grid.cellSize + 1) * (size.y / grid.cellSize + 1) > 4.0f * smallBodies + 16)
+        grid.cellSize *= 2;
+    grid.low = low;
+    grid.columns = static_cast<unsigned int>(size.x / grid.cellSize) + 1;
+    grid.rows = static_cast<unsigned int>(size.y / grid.cellSize) + 1;
+    grid.cellFirst.assign(grid.columns * grid.rows, noBody);
+    for (auto index : collidables) {
+        const Body& body = bodies[index];
+        if (body.boundingRadius > 0 && body.boundingRadius <= grid.largeRadius) {
+            uint32_t cell = grid.cellAt(body.neighbourListCentre);
+            grid.bodyCell[index] = cell;
+            grid.bodyNext[index] = grid.cellFirst[cell];
+            grid.cellFirst[cell] = index;
+        }
+    }
+}
+
+void CollisionWorld::SpatialGrid::noteVelocity(const float2& velocity) {
+    float speedSquared = dotProduct(velocity, velocity);
+    if (speedSquared > fastestSpeed * fastestSpeed)
+        fastestSpeed = std::sqrt(speedSquared);
+}
+
+// Puts an object in the cell that its neighbour list centre is now in
+void CollisionWorld::moveInGrid(uint32_t index) {
+    SpatialGrid& grid = spatialGrid;
+    if (!grid.valid || grid.bodyCell[index] == noCell)
+        return; // Large objects, and everything once the grid is to be built again, have nothing to move
+    uint32_t cell = grid.cellAt(bodies[index].neighbourListCentre);
+    if (cell == grid.bodyCell[index])
+        return;
+    removeFromGrid(index);
+    grid.bodyCell[index] = cell;
+    grid.bodyNext[index] = grid.cellFirst[cell];
+    grid.cellFirst[cell] = index;
+}
+
+void CollisionWorld::removeFromGrid(uint32_t index) {
+    SpatialGrid& grid = spatialGrid;
+    if (!grid.valid)
+        return;
+    uint32_t cell = grid.bodyCell[index];
+    if (cell != noCell) {
+        // Cells only have a few objects in, so the one before is found by going along the cell
+        uint32_t* link = &grid.cellFirst[cell];
+        while (*link != index)
+            link = &grid.bodyNext[*link];
+        *link = grid.bodyNext[index];
+        grid.bodyCell[index] = noCell;
+    }
+    else {
+        auto large = std::find(grid.largeBodies.begin(), grid.largeBodies.end(), index);
+        if (large != grid.largeBodies.end())
+            grid.largeBodies.erase(large);
+    }
+}
+
+// Gives function the index of every object that might overlap the box: the large objects, and those in cells near enough to it
+template <typename Function>
+void CollisionWorld::forEachIndexInBox(const float2& low, const float2& high, Function function) const {
+    updateSpatialGrid();
+    const SpatialGrid& grid = spatialGrid;
+    for (auto index : grid.largeBodies)
+        function(index);
+    if (grid.columns == 0)
+        return;
+
+    int firstColumn, lastColumn, firstRow, lastRow;
+    float2 reach = { grid.reach,grid.reach };
+    grid.cellRange(low - reach, high + reach, firstColumn, lastColumn, firstRow, lastRow);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            for (uint32_t index = grid.cellFirst[row * grid.columns + column]; index != noBody; index = grid.bodyNext[index])
+                function(index);
+        }
+    }
+}
+
+// Gives function every object whose bounds overlap the box, once each
+template <typename Function>
+void CollisionWorld::forEachBodyInBox(const float2& low, const float2& high, Function function) {
+    forEachIndexInBox(low, high, [&](uint32_t index) {
+        Body& body = bodies[index];
+        if (body.location.x + body.boundingRadius >= low.x && body.location.x - body.boundingRadius <= high.x
+            && body.location.y + body.boundingRadius >= low.y && body.location.y - body.boundingRadius <= high.y)
+            function(body);
+    });
+}
+
+size_t CollisionWorld::cast(const ShapeSet& shape, const float2& start, const float2& displacement, float shapeRadius,
+    BodyHandle ignore, std::span<CastHit> hits) {
+    size_t count = 0;
+    float2 end = start + displacement;
+    float2 low = { std::min(start.x, end.x) - shapeRadius,std::min(start.y, end.y) - shapeRadius };
+    float2 high = { std::max(start.x, end.x) + shapeRadius,std::max(start.y, end.y) + shapeRadius };
+    float lengthSq = dotProduct(displacement, displacement);
+    forEachBodyInBox(low, high, [&](Body& body) {
+        if (body.getHandle() == ignore)
+            return;
+        // The object's bounds have to come within reach of the path, which is much cheaper to check than its shapes
+        float2 toBody = body.location - start;
+        float t = lengthSq > 0 ? std::clamp(dotProduct(toBody, displacement) / lengthSq, 0.0f, 1.0f) : 0.0f;
+        float2 gap = toBody - displacement * t;
+        float reach = body.boundingRadius + shapeRadius;
+        if (dotProduct(gap, gap) > reach * reach)
+            return;
+
+        float2 forceVec;
+        int cell;
+        float fraction = timeToCollisionShapes(body.getShapes(), body.location, shape, start, displacement, 1.0f, forceVec, cell);
+        if (!(fraction <= 1.0f) || dotProduct(forceVec, forceVec) == 0)
+            return;
+        fraction = std::max(fraction, 0.0f);
+        float2 normal = normalise(forceVec);
+        if (dotProduct(normal, displacement) > 0)
+            normal = -normal;
+
+        // Kept nearest first, with the furthest dropped once hits is full. Ties are ordered by handle, so that the order doesn't
+        // depend on how the grid was built
+        BodyHandle handle = body.getHandle();
+        size_t position = count;
+        while (position > 0 && (hits[position - 1].fraction > fraction || (hits[position - 1].fraction == fraction && hits[position - 1].body.id > handle.id)))
+            --position;
+        if (position >= hits.size())
+            return;
+        if (count < hits.size())
+            ++count;
+        for (size_t i = count - 1; i > position; --i)
+            hits[i] = hits[i - 1];
+        hits[position] = CastHit{ handle,fraction,normal,cell };
+    });
+    return count;
+}
+
+size_t CollisionWorld::raycast(const float2& from, const float2& to, std::span<CastHit> hits, BodyHandle ignore) {
+    return castCircle(from, 0.0f, to - from, hits, ignore);
+}
+
+size_t CollisionWorld::castCircle(const float2& centre, float radius, const float2& displacement, std::span<CastHit> hits,
+    BodyHandle ignore) {
+    Circle circle = { { 0.0f,0.0f },radius };
+    ShapeSet shape = { { nullptr,nullptr },{ &circle,&circle + 1 },noTileGrid,noStaticMesh };
+    return cast(shape, centre, displacement, radius, ignore, hits);
+}
+
+size_t CollisionWorld::castBox(const float2& low, const float2& high, const float2& displacement, std::span<CastHit> hits,
+    BodyHandle ignore) {
+    // Centred on the middle of the box, going clockwise for collision with objects outside
+    float2 half = (high - low) / 2;
+    Line lines[4] = { { { -half.x,half.y },{ half.x,half.y } },{ { half.x,half.y },{ half.x,-half.y } },
+        { { half.x,-half.y },{ -half.x,-half.y } },{ { -half.x,-half.y },{ -half.x,half.y } } };
+    ShapeSet shape = { { lines,lines + 4 },{ nullptr,nullptr },noTileGrid,noStaticMesh };
+    return cast(shape, low + half, displacement, std::sqrt(dotProduct(half, half)), ignore, hits);
+}
+
+// Whether the line from p1 to p2 passes through the box, found by clipping it to the box one axis at a time (Liang and Barsky's method)
+static bool lineOverlapsBox(const float2& p1, const float2& p2, const float2& low, const float2& high) {
+    float first = 0.0f;
+    float last = 1.0f;
+    float2 direction = p2 - p1;
+    auto clip = [&](float start, float change, float boxLow, float boxHigh) {
+        if (change == 0)
+            return start >= boxLow && start <= boxHigh;
+        float t1 = (boxLow - start) / change;
+        float t2 = (boxHigh - start) / change;
+        first = std::max(first, std::min(t1, t2));
+        last = std::min(last, std::max(t1, t2));
+        return first <= last;
+    };
+    return clip(p1.x, direction.x, low.x, high.x) && clip(p1.y, direction.y, low.y, high.y);
+}
+
+static float2 nearestPointInBox(const float2& point, const float2& low, const float2& high) {
+    return { std::clamp(point.x, low.x, high.x),std::clamp(point.y, low.y, high.y) };
+}
+
+static float2 nearestPointOnLine(const float2& point, const float2& p1, const float2& p2) {
+    float2 direction = p2 - p1;
+    float lengthSq = dotProduct(direction, direction);
+    float t = lengthSq > 0 ? std::clamp(dotProduct(point - p1, direction) / lengthSq, 0.0f, 1.0f) : 0.0f;
+    return p1 + direction * t;
+}
+
+// Goes through the solid cells of a tile grid whose solid part overlaps the box, given relative to the grid's object, with the corners of
+// each solid part
+template <typename Grid, typename Function>
+static void forEachSolidCellInBox(const Grid& grid, const float2& low, const float2& high, Function function) {
+    if (grid.cells.empty())
+        return;
+    float2 size = grid.cellSize * grid.fill;
+    float2 inset = { grid.cellSize.x * (1 - grid.fill) / 2,-grid.cellSize.y * (1 - grid.fill) / 2 };
+    auto toCell = [](float position, unsigned int count) {
+        return position < 0 ? -1 : position >= count ? static_cast<int>(count) : static_cast<int>(position);
+    };
+    int firstColumn = std::max(toCell((low.x - grid.topLeft.x) / grid.cellSize.x, grid.columns), 0);
+    int lastColumn = std::min(toCell((high.x - grid.topLeft.x) / grid.cellSize.x, grid.columns), static_cast<int>(grid.columns) - 1);
+    int firstRow = std::max(toCell((grid.topLeft.y - high.y) / grid.cellSize.y, grid.rows), 0);
+    int lastRow = std::min(toCell((grid.topLeft.y - low.y) / grid.cellSize.y, grid.rows), static_cast<int>(grid.rows) - 1);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            int cell = row * grid.columns + column;
+            if (grid.cells[cell] == 0)
+                continue;
+            float2 topLeft = grid.topLeft + float2{ column * grid.cellSize.x,-row * grid.cellSize.y } + inset;
+            float2 cellLow = { topLeft.x,topLeft.y - size.y };
+            float2 cellHigh = { topLeft.x + size.x,topLeft.y };
+            if (cellLow.x <= high.x && cellHigh.x >= low.x && cellLow.y <= high.y && cellHigh.y >= low.y)
+                function(cell, cellLow, cellHigh);
+        }
+    }
+}
+
+size_t CollisionWorld::overlapBox(const float2& low, const float2& high, std::span<BodyHandle> results) {
+    size_t count = 0;
+    forEachBodyInBox(low, high, [&](Body& body) {
+        if (count >= results.size())
+            return;
+        // Everything is checked relative to the object
+        float2 boxLow = low - body.location;
+        float2 boxHigh = high - body.location;
+        ShapeRange<Line> lines = body.getLines();
+        ShapeRange<Circle> circles = body.getCircles();
+        bool overlaps = false;
+        auto checkShape = [&](uint32_t shape) {
+            if (shape < body.lineCount) {
+                const Line& line = lines.first[shape];
+                overlaps = overlaps || lineOverlapsBox(line.p1, line.p2, boxLow, boxHigh);
+            }
+            else {
+                const Circle& circle = circles.first[shape - body.lineCount];
+                float2 gap = circle.centre - nearestPointInBox(circle.centre, boxLow, boxHigh);
+                overlaps = overlaps || dotProduct(gap, gap) <= circle.radius * circle.radius;
+            }
+        };
+        if (body.staticMesh != noStaticMesh) {
+            forEachMeshShape(staticMeshes[body.staticMesh], [&](const float2& nodeLow, const float2& nodeHigh) {
+                return !overlaps && nodeLow.x <= boxHigh.x && nodeHigh.x >= boxLow.x && nodeLow.y <= boxHigh.y && nodeHigh.y >= boxLow.y;
+            }, checkShape);
+        }
+        else {
+            for (uint32_t shape = 0; shape < body.lineCount + body.circleCount && !overlaps; ++shape)
+                checkShape(shape);
+        }
+        if (body.tileGrid != noTileGrid && !overlaps)
+            forEachSolidCellInBox(tileGrids[body.tileGrid], boxLow, boxHigh, [&](int, const float2&, const float2&) { overlaps = true; });
+        if (overlaps)
+            results[count++] = body.getHandle();
+    });
+    return count;
+}
+
+NearestBody CollisionWorld::findNearest(const float2& point, float maxDistance, BodyHandle ignore) {
+    // Something near is usually found in the first few cells around the point, so the search starts there and widens until it finds
+    // something, rather than looking at every object within maxDistance
+    updateSpatialGrid();
+    float2 gridHigh = spatialGrid.low + float2{ spatialGrid.columns * spatialGrid.cellSize,spatialGrid.rows * spatialGrid.cellSize };
+    for (float radius = 2 * spatialGrid.cellSize; spatialGrid.columns > 0 && radius < maxDistance; radius *= 4) {
+        NearestBody nearest = findNearestWithin(point, radius, ignore);
+        if (nearest.body)
+            return nearest;
+        bool coversGrid = point.x - radius <= spatialGrid.low.x && point.y - radius <= spatialGrid.low.y && point.x + radius >= gridHigh.x
+            && point.y + radius >= gridHigh.y;
+        if (coversGrid)
+            break;
+    }
+    return findNearestWithin(point, maxDistance, ignore);
+}
+
+NearestBody CollisionWorld::findNearestWithin(const float2& point, float maxDistance, BodyHandle ignore) {
+    // Objects are looked at in order of how near their bounds are, until that is further than the nearest shape found
+    auto nearestFirst = [](const std::pair<float, Body*>& a, const std::pair<float, Body*>& b) {
+        return a.first > b.first;
+    };
+    nearestCandidates.clear();
+    float2 reach = { maxDistance,maxDistance };
+    forEachBodyInBox(point - reach, point + reach, [&](Body& body) {
+        if (body.getHandle() == ignore)
+            return;
+        float2 toBody = body.location - point;
+        float boundsDistance = std::sqrt(dotProduct(toBody, toBody)) - body.boundingRadius;
+        if (boundsDistance <= maxDistance)
+            nearestCandidates.emplace_back(boundsDistance, &body);
+    });
+    std::make_heap(nearestCandidates.begin(), nearestCandidates.end(), nearestFirst);
+
+    NearestBody nearest = { BodyHandle{},maxDistance,point,-1 };
+    float nearestSq = maxDistance * maxDistance;
+    while (!nearestCandidates.empty() && nearestCandidates.front().first <= nearest.distance) {
+        Body& body = *nearestCandidates.front().second;
+        std::pop_heap(nearestCandidates.begin(), nearestCandidates.end(), nearestFirst);
+        nearestCandidates.pop_back();
+
+        // Everything is checked relative to the object
+        float2 relativePoint = point - body.location;
+        auto consider = [&](const float2& nearestPoint, int cell) {
+            float2 gap = nearestPoint - relativePoint;
+            float distanceSq = dotProduct(gap, gap);
+            if (distanceSq < nearestSq) {
+                nearestSq = distanceSq;
+                nearest = { body.getHandle(),std::sqrt(distanceSq),nearestPoint + body.location,cell };
+            }
+        };
+        ShapeRange<Line> lines = body.getLines();
+        ShapeRange<Circle> circles = body.getCircles();
+        auto checkShape = [&](uint32_t shape) {
+            if (shape < body.lineCount) {
+                const Line& line = lines.first[shape];
+                consider(nearestPointOnLine(relativePoint, line.p1, line.p2), -1);
+            }
+            else {
+                const Circle& circle = circles.first[shape - body.lineCount];
+                float2 fromCentre = relativePoint - circle.centre;
+                float distance = std::sqrt(dotProduct(fromCentre, fromCentre));
+                consider(distance > circle.radius ? circle.centre + fromCentre * (circle.radius / distance) : relativePoint, -1);
+            }
+        };
+        if (body.staticMesh != noStaticMesh) {
+            forEachMeshShape(staticMeshes[body.staticMesh], [&](const float2& nodeLow, const float2& nodeHigh) {
+                float2 gap = nearestPointInBox(relativePoint, nodeLow, nodeHigh) - relativePoint;
+                return dotProduct(gap, gap) < nearestSq;
+            }, checkShape);
+        }
+        else {
+            for (uint32_t shape = 0; shape < body.lineCount + body.circleCount; ++shape)
+                checkShape(shape);
+        }
+        if (body.tileGrid != noTileGrid) {
+            float2 cellReach = { nearest.distance,nearest.distance };
+            forEachSolidCellInBox(tileGrids[body.tileGrid], relativePoint - cellReach, relativePoint + cellReach,
+                [&](int cell, const float2& cellLow, const float2& cellHigh) { consider(nearestPointInBox(relativePoint, cellLow, cellHigh), cell); });
         }
-        nextPossibleCollision->nextPossibleCollision = this; // Is 'this' correct? Make sure
-        nextPossibleCollision->forceVec = forceVec;
-        nextPossibleCollision->updateListPosition(newTimeOfCollision);
     }
+    if (!nearest.body)
+        nearest.distance = INFINITY;
+    return nearest;
 }
 
-void LineAndCircleBoundedCollidable::updateListPosition(float newTimeOfCollision) {
-    auto nodeHandle = collidables.extract(this);
+void CollisionWorld::Body::updateListPosition(float newTimeOfCollision) {
+    auto nodeHandle = world->collidables.extract(getIndex());
     timeOfCollision = newTimeOfCollision;
-    collidables.insert(std::move(nodeHandle));
+    world->collidables.insert(std::move(nodeHandle));
 }
 
-bool LineAndCircleBoundedCollidable::comparisonFunction::operator()(const LineAndCircleBoundedCollidable* const a, const LineAndCircleBoundedCollidable* const b)const
+bool CollisionWorld::comparisonFunction::operator()(const uint32_t a, const uint32_t b)const
 {
-    if (a->timeOfCollision < b->timeOfCollision)
+    if (world->bodies[a].timeOfCollision < world->bodies[b].timeOfCollision)
         return true;
-    if (a->timeOfCollision > b->timeOfCollision)
+    if (world->bodies[a].timeOfCollision > world->bodies[b].timeOfCollision)
         return false;
     return a < b; // Can't have two different objects treated as equivalent
 }
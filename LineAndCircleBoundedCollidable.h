@@ -1,70 +1,425 @@
 #pragma once
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
 #include <set>
+#include <span>
 #include <vector>
+#include "VectorMath.h"
 
-struct float2 {
-	float x;
-	float y;
+template <typename Scalar>
+struct LineOf;
+template <typename Scalar>
+struct CircleOf;
+using Line = LineOf<float>;
+using Circle = CircleOf<float>;
+
+// A run of lines or circles stored next to each other
+template <typename Shape>
+struct ShapeRange {
+	const Shape* first;
+	const Shape* last;
+	const Shape* begin() const { return first; }
+	const Shape* end() const { return last; }
 };
 
-bool operator==(const float2& a, const float2& b);
+// Counts of what the collision loop has done, for spotting event storms
+struct CollisionStatistics {
+	unsigned int eventsLastTick; // Or in the last jump made by CollisionWorld::advanceUntil
+	unsigned long long totalEvents;
+	unsigned long long restingContacts; // Collisions resolved as resting contacts instead of bounces
+	unsigned int budgetExceededTicks; // Ticks where the event budget ran out
+	unsigned int objectsHeldBack; // Objects stopped for the rest of a tick when the event budget ran out
+	unsigned long long batchedContacts; // Collisions resolved together with another collision at the same time
+	unsigned long long scans; // Times an object has been checked against others for its next collision
+	unsigned long long pairTests; // Times a pair of objects has had its time of collision calculated
+	unsigned long long neighbourListRebuilds;
+	unsigned long long heapAllocations; // Memory requested from the heap for physics, rather than reused
+	unsigned int heapAllocationsLastTick; // Should stay at 0 once a level is running
+	size_t heapBytesInUse;
+	unsigned int memoryReleases; // Times all physics memory was handed back, when the last object was destroyed
+	unsigned long long precisionFallbacks; // Collision times worked out again in double because float was too close to call
+};
 
-bool operator!=(const float2& a, const float2& b);
+// Passes allocations on to the heap, counting them
+class CountingMemoryResource : public std::pmr::memory_resource {
+	unsigned long long allocations = 0;
+	size_t bytesInUse = 0;
 
-float2 operator*(const float2& x, float a);
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+public:
+	unsigned long long getAllocations() const { return allocations; }
+	size_t getBytesInUse() const { return bytesInUse; }
+};
 
-float2 operator*(float a, const float2& x);
+// Refers to the physics state of an object. Stays the same when the object is moved, and never refers to a different object
+// after the one it was for is destroyed
+struct BodyHandle {
+	uint32_t id; // Generation of the slot in the top bits, index of the slot in the rest. 0 is never a valid handle
 
-float2 operator/(const float2& x, float a);
+	bool operator==(const BodyHandle& other) const { return id == other.id; }
+	bool operator!=(const BodyHandle& other) const { return id != other.id; }
+	explicit operator bool() const { return id != 0; }
+};
 
-float2 operator+(const float2& a, const float2& b);
+// A collision resolved during a tick, for handling after the tick instead of in onCollision
+struct CollisionEvent {
+	float time; // Ticks after the start of the tick, or of the advance it happened in
+	BodyHandle a;
+	BodyHandle b;
+	float2 normal; // Unit direction a was pushed in. b was pushed the opposite way
+	float impulse; // Size of the push along normal, not counting friction
+	int cell; // Cell of a tile grid that was hit, numbered row by row, or -1
+};
 
-float2 operator-(const float2& a, const float2& b);
+// A collision that an object would have if things carried on as they are, from LineAndCircleBoundedCollidable::predictContacts
+struct PredictedContact {
+	float time; // Ticks after the start of the current tick
+	BodyHandle other;
+	float2 location; // Where the object would be when it hits
+	float2 velocity; // The object's velocity after bouncing
+	float2 normal; // Unit direction the object would be pushed in
+	int cell; // Cell of a tile grid that would be hit, numbered row by row, or -1
+};
 
-float2& operator+=(float2& a, const float2& b);
+// An object hit by a shape cast in a spatial query
+struct CastHit {
+	BodyHandle body;
+	float fraction; // How far along the cast the hit is, from 0 at the start to 1 at the end
+	float2 normal; // Unit direction from the object towards the cast shape
+	int cell; // Cell of a tile grid that was hit, numbered row by row, or -1
+};
 
-float2& operator-=(float2& a, const float2& b);
+// The object nearest to a point, from CollisionWorld::findNearest
+struct NearestBody {
+	BodyHandle body; // Null if nothing was near enough
+	float distance;
+	float2 point; // The nearest point on the object
+	int cell; // Cell of a tile grid that is nearest, numbered row by row, or -1
+};
 
-float2 operator-(const float2& a);
 
-float dotProduct(const float2& a, const float2& b);
+class LineAndCircleBoundedCollidable;
 
-struct Matrix2x2 {
-	float xx;
-	float xy;
-	float yx;
-	float yy;
-};
+// Everything that collides with each other, and the state of the collision loop. Worlds are independent of each other, so each game can
+// have its own, and different worlds can be ticked on different threads at the same time. A world can't be used by more than one thread
+// at a time, and every object in it must be destroyed before it is
+class CollisionWorld
+{
+	friend class LineAndCircleBoundedCollidable;
+
+	struct comparisonFunction {
+		const CollisionWorld* world;
+		bool operator()(const uint32_t a, const uint32_t b) const;
+	};
+
+	// A change of velocity which will be applied at a future time, without the object needing to be polled
+	struct ScheduledVelocity {
+		float time;
+		float2 velocity;
+	};
+
+	struct Body;
+
+	// A grid of rectangular cells that are each either empty or solid, collided with as one object
+	struct TileGrid {
+		float2 topLeft; // Relative to the object's location
+		float2 cellSize;
+		float fill; // Fraction of each cell's width and height taken up by its solid part, which is centred in the cell
+		unsigned int columns;
+		unsigned int rows;
+		std::pmr::vector<unsigned char> cells; // Health of each cell, row by row from the top. 0 is empty
+
+		explicit TileGrid(std::pmr::memory_resource* memory);
+	};
+
+	// A box around some of a baked mesh's lines and circles. Either has two children or is a leaf with the shapes in it
+	struct MeshNode {
+		float2 low; // Relative to the object's location
+		float2 high;
+		uint32_t firstShape; // Index into StaticMesh::shapes
+		uint32_t shapeCount; // 0 if the node has children
+		uint32_t secondChild; // The first child is the next node
+	};
 
-float2 operator*(const Matrix2x2& a, const float2& x);
+	// A tree of boxes (bounding volume hierarchy) over an object's lines and circles, so that only the few near another object's
+	// path need checking
+	struct StaticMesh {
+		std::pmr::vector<MeshNode> nodes; // Each node is followed by its subtree, so the root is first
+		std::pmr::vector<uint32_t> shapes; // Index into the object's lines, or its circles plus its line count
 
-Matrix2x2 operator+(const Matrix2x2& a, const Matrix2x2& b);
+		explicit StaticMesh(std::pmr::memory_resource* memory);
+	};
+
+	// The lines, circles, tile grid and baked mesh of an object, or of a shape used in a spatial query
+	struct ShapeSet {
+		ShapeRange<Line> lines;
+		ShapeRange<Circle> circles;
+		uint32_t tileGrid; // Index into tileGrids, or noTileGrid
+		uint32_t staticMesh; // Index into staticMeshes, or noStaticMesh
+	};
+
+	// A grid over every object, so that finding the objects near somewhere only looks at a few cells. Each object is in the cell that
+	// its neighbour list centre is in, and can't get further from there than the grid allows for before its list is rebuilt, so an object
+	// only changes cell when its list is rebuilt or it jumps somewhere else. Objects much bigger than a cell, such as the walls, are kept
+	// apart and always looked at. Built again only when objects are added or change shape
+	struct SpatialGrid {
+		float2 low; // Bottom left corner of the first cell
+		float cellSize;
+		unsigned int columns; // 0 if there are no cells
+		unsigned int rows;
+		float largeRadius; // Objects with bigger bounds than this are in largeBodies instead of a cell
+		float reach; // Furthest that any part of an object in a cell can get from its neighbour list centre
+		float fastestSpeed; // At least as fast as anything has moved since the grid was built, for how far predictions look
+		std::pmr::vector<uint32_t> cellFirst; // Index of the first body in each cell, row by row from the bottom, or noBody
+		std::pmr::vector<uint32_t> bodyCell; // Cell of each body, by index, or noCell
+		std::pmr::vector<uint32_t> bodyNext; // Next body in the same cell, by index, or noBody
+		std::pmr::vector<uint32_t> largeBodies;
+		std::pmr::vector<float> radii; // Working space for choosing the cell size
+		bool valid;
+
+		explicit SpatialGrid(std::pmr::memory_resource* memory);
+		// The cells overlapping a box. Clamped to the grid, so that the cells at its edges also stand for everything past them
+		void cellRange(const float2& boxLow, const float2& boxHigh, int& firstColumn, int& lastColumn, int& firstRow, int& lastRow) const;
+		uint32_t cellAt(const float2& point) const;
+		void noteVelocity(const float2& velocity);
+	};
+
+	// Two objects touching at a collision, with the direction of the force between them
+	struct Contact {
+		Body* a;
+		Body* b;
+		float2 forceVec;
+		int cell; // Cell of a tile grid being hit, or -1
+		bool resting = false;
+		float initialSpeed = 0; // Speed of a relative to b along forceVec before the collision
+		float finalSpeed = 0; // Speed along forceVec that the collision should leave them with
+		float impulse = 0;
+	};
+
+	// The physics state of an object. These are kept in a table and refer to each other by handle, so an object can be moved
+	// without anything else needing to be fixed up
+	struct Body {
+		CollisionWorld* world;
+		LineAndCircleBoundedCollidable* owner; // Null if the slot is free
+		uint32_t generation; // Changed every time the slot is reused
+		float2 location;
+		float2 velocity;
+		float timeOfCollision;
+		float timeAhead;
+		BodyHandle nextPossibleCollision;
+		unsigned int firstLine; // Index into lineStore
+		unsigned int lineCount;
+		unsigned int firstCircle; // Index into circleStore
+		unsigned int circleCount;
+		float2 forceVec;
+		int contactCell; // Cell of a tile grid hit in the collision with nextPossibleCollision, or -1
+		uint32_t tileGrid; // Index into tileGrids, or noTileGrid
+		uint32_t staticMesh; // Index into staticMeshes, or noStaticMesh
+		std::pmr::vector<ScheduledVelocity> scheduledVelocities; // Sorted by time
+		float lastCollisionTime;
+		unsigned int repeatedCollisions; // Number of collisions in a row at lastCollisionTime
+		std::pmr::vector<BodyHandle> simultaneousCollisions; // Other objects that collide at almost the same time as nextPossibleCollision
+		float boundingRadius; // Distance from location to the furthest point of any line or circle
+		std::pmr::vector<BodyHandle> neighbours; // Objects near enough to possibly be hit. If a is in b's neighbours, b is in a's
+		float2 neighbourListCentre; // Location when neighbours was last rebuilt
+		float neighbourListExpiry; // Time when the object might have moved far enough for neighbours to be missing something
+		bool neighbourListValid;
+
+		// Only the world and the lists are set up. The rest is filled in by whatever makes the body
+		explicit Body(CollisionWorld* world);
+		BodyHandle getHandle() const;
+		uint32_t getIndex() const;
+		void checkForNextCollision();
+		void rebuildNeighbourList();
+		void removeFromNeighbourLists();
+		// Collisions after timeLimit may be missed
+		float timeToCollisionWith(const Body& other, float2& collisionForceVec, int& collisionCell, float timeLimit = std::numeric_limits<float>::infinity()) const;
+		float timeToReach(const Body& other) const;
+		ShapeRange<Line> getLines() const;
+		ShapeRange<Circle> getCircles() const;
+		ShapeSet getShapes() const;
+		void gatherSimultaneousContacts(float time, std::pmr::vector<Contact>& contacts);
+		void updateListPosition(float newTimeOfCollision);
+		void unpair();
+		void changeTrajectory(const float2& newLocation, const float2& newVelocity);
+		void scheduleVelocityChange(float time, const float2& newVelocity);
+		void applyScheduledVelocity();
+		unsigned int countRepeatedCollision(float time);
+	};
 
-struct Line;
-struct Circle;
+	// All physics memory comes from pool, apart from the queue's nodes and working space for collisions which are reused instead.
+	// Everything in pool is handed back at once when the last object is destroyed. The resources are first, so that they are made
+	// before and destroyed after the containers using them
+	CountingMemoryResource heap;
+	std::pmr::unsynchronized_pool_resource pool;
+	std::pmr::unsynchronized_pool_resource queueNodePool;
+	std::pmr::vector<Body> bodies; // Slot table, indexed by the lower bits of a handle. On the heap, as it outlives releaseMemory
+	std::pmr::vector<uint32_t> freeSlots;
+	std::pmr::set<uint32_t, comparisonFunction> collidables; // Indices of bodies in use, soonest collision first
+	CollisionStatistics statistics;
+	double elapsed; // Ticks gone since the world was made
+	unsigned int maxEventsPerTick;
+	float neighbourSkin;
+	std::pmr::vector<Line> lineStore; // The lines of every object, with each object's lines next to each other
+	std::pmr::vector<Circle> circleStore; // The circles of every object, with each object's circles next to each other
+	size_t unusedShapes; // Lines and circles in the stores that no longer belong to any object
+	std::pmr::vector<TileGrid> tileGrids;
+	std::pmr::vector<uint32_t> freeTileGrids;
+	std::pmr::vector<StaticMesh> staticMeshes;
+	std::pmr::vector<uint32_t> freeStaticMeshes;
+	bool recordingCollisionEvents;
+	std::pmr::vector<CollisionEvent> collisionEvents; // Collisions resolved so far this tick, if they are being recorded
+	mutable SpatialGrid spatialGrid; // Only a faster way of finding objects, so it can be brought up to date when only looking
+	// Working space, kept so that it doesn't need allocating again
+	std::pmr::vector<Contact> contacts;
+	std::pmr::vector<Body*> participants;
+	std::pmr::vector<BodyHandle> collided;
+	std::pmr::vector<BodyHandle> toCheck;
+	std::pmr::vector<std::pair<BodyHandle, int>> cellsHit;
+	std::pmr::vector<Body*> heldBack;
+	std::pmr::vector<std::pair<float, Body*>> candidates;
+	std::pmr::vector<std::pair<float, Body*>> nearlySoonest;
+	std::pmr::vector<uint32_t> neighbourCandidates;
+	std::pmr::vector<std::pair<float, Body*>> nearestCandidates;
+	std::pmr::vector<std::pair<float2, float2>> shapeBoxes;
+
+	CollisionWorld& operator=(const CollisionWorld&) = delete;
+	CollisionWorld(const CollisionWorld&) = delete;
+
+	Body* getBody(BodyHandle handle); // Null if the object has been destroyed
+	void destroyBody(BodyHandle handle);
+	void releaseMemory();
+	void resolveContacts(std::pmr::vector<Contact>& contacts);
+	float timeToCollisionShapes(const ShapeSet& a, const float2& aLocation, const ShapeSet& b, const float2& bLocation,
+		const float2& relativeVelocity, float timeLimit, float2& collisionForceVec, int& collisionCell) const;
+	static float timeToCollisionTiles(const TileGrid& grid, ShapeRange<Line> lines, ShapeRange<Circle> circles, const float2& offset,
+		const float2& relativeVelocity, float timeLimit, float2& collisionForceVec, int& collisionCell);
+	static float timeToCollisionMesh(const StaticMesh& mesh, ShapeRange<Line> meshLines, ShapeRange<Circle> meshCircles, ShapeRange<Line> lines,
+		ShapeRange<Circle> circles, const float2& offset, const float2& relativeVelocity, float timeLimit, float2& collisionForceVec);
+	static uint32_t buildMeshNode(StaticMesh& mesh, const std::pmr::vector<std::pair<float2, float2>>& shapeBoxes, uint32_t firstShape, uint32_t shapeCount);
+	void freeStaticMesh(Body& body);
+	template <typename NodeFilter, typename Function>
+	static void forEachMeshShape(const StaticMesh& mesh, NodeFilter nodeFilter, Function function);
+	void updateSpatialGrid() const;
+	void moveInGrid(uint32_t index);
+	void removeFromGrid(uint32_t index);
+	template <typename Function>
+	void forEachIndexInBox(const float2& low, const float2& high, Function function) const;
+	template <typename Function>
+	void forEachBodyInBox(const float2& low, const float2& high, Function function);
+	size_t cast(const ShapeSet& shape, const float2& start, const float2& displacement, float shapeRadius, BodyHandle ignore,
+		std::span<CastHit> hits);
+	NearestBody findNearestWithin(const float2& point, float maxDistance, BodyHandle ignore);
+	float advance(float duration, bool stopAtCollision);
+	void holdBackRemainingEvents(float until);
+	template <typename Archive>
+	void transferState(Archive& archive);
+public:
+	CollisionWorld();
+	~CollisionWorld(); // Out of line, as lines and circles are only defined in the source file
+	void doTickOfCollisions();
+	// Moves everything forward to 'time', going straight from each collision to the next instead of a tick at a time. Objects are only
+	// moved when they collide, or at the end, so this is much faster than ticking when nothing needs showing in between. Stops straight
+	// after the first collision if stopAtCollision is set, so that its effects on the game can be handled. Times given to the world
+	// afterwards, such as for scheduled velocity changes, count from where it stopped. Returns the time reached
+	double advanceUntil(double time, bool stopAtCollision = false);
+	// Ticks gone since the world was made, counting those gone through by advanceUntil
+	double getTime() const { return elapsed; }
+	// Limits the number of collisions resolved in one tick. Objects with collisions left over are stopped until the next tick
+	void setMaxEventsPerTick(unsigned int maxEvents) { maxEventsPerTick = maxEvents; }
+	const CollisionStatistics& getStatistics() const { return statistics; }
+	// Collisions are only recorded while this is turned on, so that nothing is spent on them otherwise
+	void setCollisionEventRecording(bool record);
+	// Every collision resolved in the last tick, in the order they happened. Valid until the next tick
+	std::span<const CollisionEvent> getCollisionEvents() const { return collisionEvents; }
+	// Objects are only checked for collisions with others within this distance of their bounds. A larger skin means neighbour
+	// lists are rebuilt less often, but hold more objects. Should be set between ticks
+	void setNeighbourSkin(float skin);
+	// Rearranges the physics of every object, and their lines and circles, so that objects near each other are stored near each other.
+	// Also removes gaps left by destroyed objects. Every object gets a new handle, so handles, snapshots and tick states from before no
+	// longer find anything. Should be called between ticks, e.g. after setting up a level
+	void sortStorageSpatially();
+	// Saves the state of the world and of every object's physics into 'blob', replacing what was there, for putting back with restore.
+	// The objects themselves aren't saved, so settings and callbacks stay with them
+	void snapshot(std::vector<unsigned char>& blob) const;
+	// Puts the world back exactly as it was when 'blob' was saved, so that it carries on just as it would have from there. The objects alive
+	// then must be the ones alive now, with the same handles, e.g. from setting up the level the same way. Throws without changing anything
+	// if they aren't, or if the blob is from a different version. Statistics aren't saved, as they count the work done
+	void restore(std::span<const unsigned char> blob);
+
+	// The part of the world that ticks change, for saving every tick and putting back cheaply, e.g. by RollbackBuffer. Each property of
+	// the objects' physics is a flat array with an entry for each object in turn, and their lists are put one after the other. Shapes
+	// aren't kept, apart from the health of tile grid cells, so it can only be put back into a world with the same objects, shaped the same
+	// way. Its arrays are kept between saves, so saving into it again doesn't allocate once they have grown to fit
+	class TickState {
+		friend class CollisionWorld;
+
+		double elapsed = 0;
+		std::vector<uint32_t> slots; // Index of each object's slot, soonest collision first as in the queue
+		std::vector<uint32_t> generations;
+		std::vector<float2> locations;
+		std::vector<float2> velocities;
+		std::vector<float> timesOfCollision;
+		std::vector<float> timesAhead;
+		std::vector<BodyHandle> nextPossibleCollisions;
+		std::vector<float2> forceVecs;
+		std::vector<int> contactCells;
+		std::vector<float> lastCollisionTimes;
+		std::vector<unsigned int> repeatedCollisions;
+		std::vector<float2> neighbourListCentres;
+		std::vector<float> neighbourListExpiries;
+		std::vector<unsigned char> neighbourListValid;
+		// Where each object's list ends in the one after
+		std::vector<uint32_t> scheduledEnds;
+		std::vector<ScheduledVelocity> scheduledVelocities;
+		std::vector<uint32_t> simultaneousEnds;
+		std::vector<BodyHandle> simultaneousCollisions;
+		std::vector<uint32_t> neighbourEnds;
+		std::vector<BodyHandle> neighbours;
+		std::vector<unsigned char> cells; // Of every tile grid, one after the other
+	public:
+		// Bytes taken up by what was saved
+		size_t size() const;
+	};
+	void saveTickState(TickState& state) const;
+	// Puts the world back as it was when 'state' was saved, so that it carries on just as it would have from there. Throws without
+	// changing anything if the objects alive aren't the ones that were then. Statistics aren't put back, as they count the work done
+	void restoreTickState(const TickState& state);
+	// Spatial queries, for finding objects without waiting to collide with them. They look at where everything is now, so should be made
+	// between ticks. They don't allocate memory, apart from building the grid behind them when the objects have changed
+	// Finds what the line from 'from' to 'to' passes through. The nearest hits, one for each object, are written to 'hits' nearest first,
+	// and the number written is returned
+	size_t raycast(const float2& from, const float2& to, std::span<CastHit> hits, BodyHandle ignore = {});
+	// The same, for a circle moved by 'displacement'. Objects that it already overlaps at the start may not be found
+	size_t castCircle(const float2& centre, float radius, const float2& displacement, std::span<CastHit> hits, BodyHandle ignore = {});
+	// The same, for a rectangle with corners low and high
+	size_t castBox(const float2& low, const float2& high, const float2& displacement, std::span<CastHit> hits, BodyHandle ignore = {});
+	// Finds objects with a line, circle or solid tile grid cell overlapping the rectangle with corners low and high. Up to results.size()
+	// of them are written to 'results', and the number written is returned
+	size_t overlapBox(const float2& low, const float2& high, std::span<BodyHandle> results);
+	// Finds the object with a line, circle or solid tile grid cell nearest to 'point', if any are within maxDistance
+	NearestBody findNearest(const float2& point, float maxDistance = std::numeric_limits<float>::infinity(), BodyHandle ignore = {});
+};
 
 class LineAndCircleBoundedCollidable
 {
-	struct comparisonFunction {
-		bool operator()(const LineAndCircleBoundedCollidable* const a, const LineAndCircleBoundedCollidable* const b) const;
-	};
+	friend class CollisionWorld;
 
-	static std::set<LineAndCircleBoundedCollidable*, comparisonFunction> collidables;
-	float2 location;
-	float2 velocity;
-	float timeOfCollision;
-	float timeAhead;
-	LineAndCircleBoundedCollidable* nextPossibleCollision;
-	std::vector<Line> lines;
-	std::vector<Circle> circles;
-	float2 forceVec;
+	using Body = CollisionWorld::Body;
+
+	CollisionWorld* world;
+	BodyHandle handle;
 
 	LineAndCircleBoundedCollidable& operator=(const LineAndCircleBoundedCollidable&) = delete;
 	LineAndCircleBoundedCollidable(const LineAndCircleBoundedCollidable&) = delete;
 
-	void checkForNextCollision();
-	void updateListPosition(float newTimeOfCollision);
+	Body& body() const;
 	virtual void onCollision() {}
+	// Called after onCollision when a cell of this object's tile grid is hit
+	virtual void onCellCollision(unsigned int /*column*/, unsigned int /*row*/) {}
 	// Friction factor for slowing down objects perpedicular to the surface of collision
 	virtual float getCorFactorPerp() { return 1.0f; }
 	// Friction factor for slowing down objects tangentially to the surface of collision
@@ -72,17 +427,43 @@ class LineAndCircleBoundedCollidable
 	// Determines how resistant to acceleration the object is in different directions
 	virtual const Matrix2x2 getInverseMassMatrix() = 0;
 public:
-	static void doTickOfCollisions();
-	LineAndCircleBoundedCollidable(const float2& initLocation, const float2& initVelocity);
+	LineAndCircleBoundedCollidable(CollisionWorld& world, const float2& initLocation, const float2& initVelocity);
 	~LineAndCircleBoundedCollidable();
+	// Moving only hands over the handle. A moved-from object can only be destroyed or assigned to
 	LineAndCircleBoundedCollidable(LineAndCircleBoundedCollidable&&) noexcept;
 	LineAndCircleBoundedCollidable& operator=(LineAndCircleBoundedCollidable&&) noexcept;
+	BodyHandle getHandle() const { return handle; }
+	CollisionWorld& getWorld() const { return *world; }
 	void changeTrajectory(const float2& newLocation, const float2& newVelocity);
 	void changeVelocity(const float2& newVelocity);
+	// Changes the velocity at 'time' ticks after the start of the current tick. Handled by the collision queue, so nothing needs to be polled
+	void scheduleVelocityChange(float time, const float2& newVelocity);
+	// Moves through each waypoint (time, location) in turn at a constant velocity between them, then stops at the last one
+	// Times are in ticks after the start of the current tick, and collisions along the way are not corrected for
+	void schedulePath(const std::vector<std::pair<float, float2>>& waypoints);
+	void clearScheduledVelocityChanges();
 	// Lines should be added with p2 clockwise from p1 for collision with objects outside
 	void addLine(const float2& p1, const float2& p2);
 	void addCircle(const float2& centre, float radius);
-	float2 getLocation() { return location; }
-	float2 getVelocity() { return velocity; }
+	// Makes the object a grid of columns x rows cells of size cellSize, with its top left corner at topLeft, all empty to start with.
+	// The solid part of a cell is scaled by fill about the cell's centre. Meant for objects with no lines or circles
+	void makeTileGrid(const float2& topLeft, const float2& cellSize, unsigned int columns, unsigned int rows, float fill);
+	// Setting a cell to 0 empties it. Emptying a cell is cheap, but filling one makes everything nearby check for collisions again.
+	// Both throw if the object has no tile grid or the cell is outside it
+	void setCell(unsigned int column, unsigned int row, unsigned char health);
+	unsigned char getCell(unsigned int column, unsigned int row) const;
+	// Builds a tree of boxes over the object's lines and circles, so that checking something against them takes time growing with the
+	// log of how many there are. Meant for level outlines and other objects made of many shapes. Adding a line or circle afterwards
+	// undoes it until this is called again
+	void bakeStaticMesh();
+	// Predicts the object's next collisions, up to maxContacts of them and up to 'horizon' ticks after the start of the current tick, without
+	// changing any object. Everything else is assumed to carry on at its current velocity, unaffected by the object or each other, and hit
+	// tile grid cells aren't emptied. Scheduled velocity changes are ignored. Cheap enough to use every frame for many objects. Like the
+	// spatial queries, it first brings the world's grid up to date, which rebuilds it, and may allocate, if objects have changed since
+	void predictContacts(float horizon, unsigned int maxContacts, std::vector<PredictedContact>& contacts) const;
+	// The same, as if the object were at 'location' with 'velocity' instead
+	void predictContacts(const float2& location, const float2& velocity, float horizon, unsigned int maxContacts,
+		std::vector<PredictedContact>& contacts) const;
+	float2 getLocation() { return body().location; }
+	float2 getVelocity() { return body().velocity; }
 };
-
@@ -0,0 +1,31 @@
+#pragma once
+#include "VectorMath.h"
+
+// The calculations of when two shapes moving relative to each other first touch, which the collision world does for every pair of shapes it
+// checks. Given here on their own so that they can be timed and checked apart from the world. Lines go from p1 to p2, and only collide
+// with things on their outside, with p2 clockwise from p1
+namespace NarrowPhase {
+
+	// When the line, relative to a point at the origin and moving at relativeVelocity, reaches the point. NaN if it misses, and negative
+	// if it already has. Sets closeCall if float may have got it wrong
+	float pointLineTimeToCollision(const float2& p1, const float2& p2, const float2& relativeVelocity, bool& closeCall);
+
+	// When the circle, relative to a point at the origin and moving at relativeVelocity, reaches the point. NaN if it misses, and negative
+	// if it already has. Sets closeCall if float may have got it wrong
+	float pointCircleTimeToCollision(const float2& centre, float radius, const float2& relativeVelocity, bool& closeCall);
+
+	// The rest work in double instead when float is too close to call, as the world does. They return infinity for no collision, and 0 for
+	// shapes that have only just started overlapping. forceVec, if given, is set to the direction the second shape is pushed in
+
+	// When line b, moving at relativeVelocity compared to line a, hits it
+	float timeToCollisionLines(const float2& a1, const float2& a2, const float2& b1, const float2& b2, const float2& relativeVelocity,
+		float2* forceVec = nullptr);
+
+	// When the line, moving at relativeVelocity compared to the circle, hits it
+	float timeToCollisionCircleLine(const float2& centre, float radius, const float2& p1, const float2& p2, const float2& relativeVelocity,
+		float2* forceVec = nullptr);
+
+	// When circle b, moving at relativeVelocity compared to circle a, hits it
+	float timeToCollisionCircles(const float2& aCentre, float aRadius, const float2& bCentre, float bRadius, const float2& relativeVelocity,
+		float2* forceVec = nullptr);
+}
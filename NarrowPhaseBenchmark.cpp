@@ -0,0 +1,340 @@
+#include "NarrowPhase.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Times each narrow phase calculation on its own, on sets of random inputs of each kind, and prints the results as JSON so that they can
+// be compared across builds. The results of every call are added into a checksum, which is printed so that the calls can't be left out
+//   -calls N  Calls timed for each function and kind of input (default 2000000)
+//   -seed S   Seed for the inputs (default 1)
+
+// Kinds of input. Grazing is right at the edge of a hit, e.g. a point meeting the very end of a line. Intersecting shapes already overlap,
+// or have already passed through each other. Parallel is a line moving along itself, or for circles, where nothing is parallel, shapes
+// that aren't moving compared to each other
+enum class Distribution {
+    hits,
+    misses,
+    grazing,
+    intersecting,
+    parallel
+};
+
+constexpr Distribution distributions[] = { Distribution::hits, Distribution::misses, Distribution::grazing, Distribution::intersecting,
+    Distribution::parallel };
+constexpr const char* distributionNames[] = { "hits", "misses", "grazing", "intersecting", "parallel" };
+// Inputs made for each function and kind of input. Few enough that they stay in the cache, so that the calculation is what is timed
+constexpr size_t casesPerSet = 1024;
+// How far from the edge of a hit grazing inputs are, as a fraction of the sizes involved
+constexpr float grazeDistance = 1e-6f;
+
+// The inputs of one call. Which of them are used depends on the function
+struct Case {
+    float2 a1;
+    float2 a2;
+    float2 b1;
+    float2 b2;
+    float aRadius;
+    float bRadius;
+    float2 velocity;
+};
+
+// Random sizes and directions on the scale of the game's: objects a tenth of the screen across, moving a hundredth of it each tick
+class CaseRandom {
+    std::minstd_rand random;
+public:
+    explicit CaseRandom(uint32_t seed) : random{ seed } {}
+
+    float uniform(float low, float high) {
+        return std::uniform_real_distribution<float>{ low,high }(random);
+    }
+    bool coin() {
+        return uniform(0.0f, 1.0f) < 0.5f;
+    }
+    float2 direction() {
+        float angle = uniform(0.0f, 6.2831853f);
+        return { std::cos(angle),std::sin(angle) };
+    }
+    float2 location() {
+        return direction() * uniform(0.0f, 0.5f);
+    }
+    float length() {
+        return uniform(0.05f, 0.2f);
+    }
+    float radius() {
+        return uniform(0.01f, 0.05f);
+    }
+    float speed() {
+        return uniform(0.005f, 0.03f);
+    }
+    float time() {
+        return uniform(0.05f, 1.0f);
+    }
+    float graze() {
+        return uniform(-grazeDistance, grazeDistance);
+    }
+};
+
+static float2 perpendicular(const float2& direction) {
+    return { -direction.y,direction.x };
+}
+
+static float2 rotate(const float2& direction, float angle) {
+    return { direction.x * std::cos(angle) - direction.y * std::sin(angle),direction.x * std::sin(angle) + direction.y * std::cos(angle) };
+}
+
+// Where a circle of 'radius' should be, relative to a point, for it to move at 'velocity' and pass the point 'offset' radii from its centre.
+// If it hits, it first touches the point at 'contactTime'
+static float2 circleApproach(const float2& velocity, float radius, float offset, float contactTime) {
+    float speed = std::sqrt(dotProduct(velocity, velocity));
+    float closestTime = contactTime + (std::fabs(offset) < 1 ? std::sqrt(1 - offset * offset) * radius / speed : 0.0f);
+    return -velocity * closestTime + perpendicular(velocity / speed) * offset * radius;
+}
+
+static float missFraction(CaseRandom& random) {
+    return random.coin() ? random.uniform(-1.0f, -0.3f) : random.uniform(1.3f, 2.0f);
+}
+
+// A line relative to a point at the origin, in a1 and a2
+static Case pointLineCase(Distribution distribution, CaseRandom& random) {
+    Case input{};
+    input.velocity = random.direction() * random.speed();
+    float2 velocityDirection = input.velocity / std::sqrt(dotProduct(input.velocity, input.velocity));
+    if (distribution == Distribution::parallel) {
+        input.a1 = perpendicular(velocityDirection) * random.uniform(-0.01f, 0.01f) - velocityDirection * random.uniform(0.0f, 0.2f);
+        input.a2 = input.a1 + velocityDirection * random.length();
+        return input;
+    }
+    float2 line = rotate(velocityDirection, random.uniform(0.3f, 2.84f)) * random.length(); // Well away from parallel
+    float along = random.uniform(0.05f, 0.95f); // Fraction along the line of the part that reaches the point
+    float time = random.time();
+    if (distribution == Distribution::misses)
+        along = missFraction(random);
+    else if (distribution == Distribution::grazing)
+        along = (random.coin() ? 0.0f : 1.0f) + random.graze();
+    else if (distribution == Distribution::intersecting)
+        time = -time;
+    input.a1 = -along * line - input.velocity * time;
+    input.a2 = input.a1 + line;
+    return input;
+}
+
+// A circle relative to a point at the origin, in a1 and aRadius
+static Case pointCircleCase(Distribution distribution, CaseRandom& random) {
+    Case input{};
+    input.aRadius = random.radius();
+    input.velocity = random.direction() * random.speed();
+    float side = random.coin() ? 1.0f : -1.0f;
+    switch (distribution) {
+    case Distribution::hits:
+        input.a1 = circleApproach(input.velocity, input.aRadius, side * random.uniform(0.0f, 0.95f), random.time());
+        break;
+    case Distribution::misses:
+        input.a1 = circleApproach(input.velocity, input.aRadius, side * random.uniform(1.05f, 3.0f), random.time());
+        break;
+    case Distribution::grazing:
+        input.a1 = circleApproach(input.velocity, input.aRadius, side * (1.0f + random.graze()), random.time());
+        break;
+    case Distribution::intersecting:
+        input.a1 = random.direction() * input.aRadius * random.uniform(0.0f, 0.9f);
+        break;
+    case Distribution::parallel:
+        input.velocity = { 0.0f,0.0f };
+        input.a1 = random.direction() * input.aRadius * random.uniform(1.1f, 3.0f);
+        break;
+    }
+    return input;
+}
+
+// Line b, in b1 and b2, moving towards line a, in a1 and a2, with its b1 end leading
+static Case linesCase(Distribution distribution, CaseRandom& random) {
+    Case input{};
+    input.a1 = random.location();
+    float2 aDirection = random.direction();
+    float2 a = aDirection * random.length();
+    input.a2 = input.a1 + a;
+    float2 outside = perpendicular(aDirection);
+    // Facing a, and turned so that b2 is further from it than b1
+    float2 b = rotate(-aDirection, random.uniform(-0.5f, 0.0f)) * random.length();
+    float speed = random.speed();
+    input.velocity = -outside * speed + aDirection * speed * random.uniform(-0.5f, 0.5f);
+    float along = random.uniform(0.05f, 0.95f);
+    float time = random.time();
+    switch (distribution) {
+    case Distribution::misses:
+        along = missFraction(random);
+        break;
+    case Distribution::grazing:
+        along = random.graze(); // b1 meets a1, with b stretching away from a
+        break;
+    case Distribution::intersecting:
+        time = -random.uniform(0.05f, 0.5f);
+        break;
+    case Distribution::parallel:
+        input.velocity = aDirection * speed;
+        b = -a;
+        input.b1 = input.a1 + a * random.uniform(-0.5f, 1.5f) + outside * (random.coin() ? 0.0f : random.uniform(0.0f, 0.01f));
+        input.b2 = input.b1 + b;
+        return input;
+    default:
+        break;
+    }
+    input.b1 = input.a1 + along * a - input.velocity * time;
+    input.b2 = input.b1 + b;
+    return input;
+}
+
+// A line, in b1 and b2, moving towards a circle, in a1 and aRadius
+static Case circleLineCase(Distribution distribution, CaseRandom& random) {
+    Case input{};
+    input.a1 = random.location();
+    input.aRadius = random.radius();
+    float2 lineDirection = random.direction();
+    float2 line = lineDirection * random.length();
+    float2 outside = perpendicular(lineDirection);
+    float speed = random.speed();
+    input.velocity = outside * speed + lineDirection * speed * random.uniform(-0.5f, 0.5f);
+    float along = random.uniform(0.05f, 0.95f);
+    float time = random.time();
+    switch (distribution) {
+    case Distribution::misses:
+        along = missFraction(random);
+        break;
+    case Distribution::grazing:
+        input.velocity = outside * speed; // Straight on, so that the circle meets the very end of the line
+        along = (random.coin() ? 0.0f : 1.0f) + random.graze();
+        break;
+    case Distribution::intersecting:
+        time = -random.uniform(0.05f, 0.9f) * input.aRadius / speed; // Overlapping by up to 90% of the radius
+        break;
+    case Distribution::parallel:
+        input.velocity = lineDirection * speed;
+        input.b1 = input.a1 - outside * (input.aRadius + (random.coin() ? 0.0f : random.uniform(0.0f, 0.5f) * input.aRadius))
+            - line * random.uniform(-0.5f, 1.5f);
+        input.b2 = input.b1 + line;
+        return input;
+    default:
+        break;
+    }
+    input.b1 = input.a1 - outside * input.aRadius - along * line - input.velocity * time;
+    input.b2 = input.b1 + line;
+    return input;
+}
+
+// Circle b, in b1 and bRadius, moving towards circle a, in a1 and aRadius
+static Case circlesCase(Distribution distribution, CaseRandom& random) {
+    Case input{};
+    input.a1 = random.location();
+    input.aRadius = random.radius();
+    input.bRadius = random.radius();
+    // Circles touch when their centres are the sum of their radii apart, so it is the same as a point and a circle of that radius
+    Case relative = pointCircleCase(distribution, random);
+    float scale = (input.aRadius + input.bRadius) / relative.aRadius;
+    input.b1 = input.a1 + relative.a1 * scale;
+    input.velocity = relative.velocity;
+    return input;
+}
+
+// What a result adds to the checksum. Misses add 1, so that they count too
+static double checksumOf(float time) {
+    return std::isfinite(time) ? time : 1.0;
+}
+
+static double checksumOf(float time, const float2& forceVec) {
+    return checksumOf(time) + forceVec.x + forceVec.y;
+}
+
+// Makes a set of inputs of each kind, then times 'calls' calls of 'call' on each set. Hits and misses are made again until 'call' agrees
+// that they are, as some of the misses made would hit after all
+template <typename MakeCase, typename Call>
+static double runFunction(const char* name, MakeCase makeCase, Call call, size_t calls, uint32_t seed, bool& first) {
+    double total = 0;
+    for (Distribution distribution : distributions) {
+        CaseRandom random{ seed + static_cast<uint32_t>(distribution) };
+        std::vector<Case> cases;
+        cases.reserve(casesPerSet);
+        while (cases.size() < casesPerSet) {
+            Case input = makeCase(distribution, random);
+            for (int attempt = 0; attempt < 100; ++attempt) {
+                bool hit = call(input).second;
+                if ((distribution != Distribution::hits || hit) && (distribution != Distribution::misses || !hit))
+                    break;
+                input = makeCase(distribution, random);
+            }
+            cases.push_back(input);
+        }
+
+        double checksum = 0;
+        for (auto& input : cases) // Warms the cache and branch predictors
+            checksum += call(input).first;
+        checksum = 0;
+        size_t done = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (done < calls) {
+            for (auto& input : cases)
+                checksum += call(input).first;
+            done += cases.size();
+        }
+        std::chrono::duration<double, std::nano> taken = std::chrono::steady_clock::now() - start;
+        total += checksum;
+
+        if (!first)
+            std::printf(",\n");
+        first = false;
+        std::printf("    { \"function\": \"%s\", \"distribution\": \"%s\", \"calls\": %zu, \"nsPerCall\": %.3f, \"callsPerSecond\": %.0f, \"checksum\": %.9g }",
+            name, distributionNames[static_cast<int>(distribution)], done, taken.count() / done, done / taken.count() * 1e9, checksum);
+        std::fflush(stdout);
+    }
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    size_t calls = 2000000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "-calls") == 0)
+            calls = std::strtoull(argv[++i], nullptr, 10);
+        else if (i + 1 < argc && std::strcmp(argv[i], "-seed") == 0)
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else {
+            std::fprintf(stderr, "Usage: %s [-calls N] [-seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Each call gives what it adds to the checksum, and whether the shapes collide
+    std::printf("{\n  \"results\": [\n");
+    bool first = true;
+    double checksum = 0;
+    checksum += runFunction("pointLineTimeToCollision", pointLineCase, [](const Case& input) {
+        bool closeCall = false;
+        float time = NarrowPhase::pointLineTimeToCollision(input.a1, input.a2, input.velocity, closeCall);
+        return std::pair{ checksumOf(time) + closeCall,!std::isnan(time) && time >= 0 };
+    }, calls, seed, first);
+    checksum += runFunction("pointCircleTimeToCollision", pointCircleCase, [](const Case& input) {
+        bool closeCall = false;
+        float time = NarrowPhase::pointCircleTimeToCollision(input.a1, input.aRadius, input.velocity, closeCall);
+        return std::pair{ checksumOf(time) + closeCall,!std::isnan(time) && time >= 0 };
+    }, calls, seed, first);
+    checksum += runFunction("timeToCollisionLines", linesCase, [](const Case& input) {
+        float2 forceVec;
+        float time = NarrowPhase::timeToCollisionLines(input.a1, input.a2, input.b1, input.b2, input.velocity, &forceVec);
+        return std::pair{ checksumOf(time, forceVec),std::isfinite(time) };
+    }, calls, seed, first);
+    checksum += runFunction("timeToCollisionCircleLine", circleLineCase, [](const Case& input) {
+        float2 forceVec;
+        float time = NarrowPhase::timeToCollisionCircleLine(input.a1, input.aRadius, input.b1, input.b2, input.velocity, &forceVec);
+        return std::pair{ checksumOf(time, forceVec),std::isfinite(time) };
+    }, calls, seed, first);
+    checksum += runFunction("timeToCollisionCircles", circlesCase, [](const Case& input) {
+        float2 forceVec;
+        float time = NarrowPhase::timeToCollisionCircles(input.a1, input.aRadius, input.b1, input.bRadius, input.velocity, &forceVec);
+        return std::pair{ checksumOf(time, forceVec),std::isfinite(time) };
+    }, calls, seed, first);
+    std::printf("\n  ],\n  \"checksum\": %.9g\n}\n", checksum);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "DisplaySystem.h"
+
+// Stands in for DisplaySystem.cpp where there is no window or OpenGL, e.g. the headless driver. Nothing is drawn, but
+// VisualComponents still keep where they are so that the game behaves the same as with a display
+
+namespace DisplaySystem {
+
+    void update() {}
+
+    void cleanup() {}
+
+    void showMany(std::string, const float*, const float*, size_t, float, float) {}
+
+    VisualComponent::VisualComponent(std::string filename, float x, float y, float w, float h)
+        : imagePath{ std::move(filename) }, xLoc{ x }, yLoc{ y }, wDim{ w }, hDim{ h }, instanceID{ 0 } {}
+
+    VisualComponent::~VisualComponent() {}
+
+    void VisualComponent::changeLocation(float x, float y) {
+        xLoc = x;
+        yLoc = y;
+    }
+
+    void VisualComponent::changeLocation(float x, float y, float w, float h) {
+        xLoc = x;
+        yLoc = y;
+        wDim = w;
+        hDim = h;
+    }
+
+    void VisualComponent::changeImage(std::string filename) {
+        imagePath = std::move(filename);
+    }
+
+    void VisualComponent::change(std::string filename, float x, float y, float w, float h) {
+        imagePath = std::move(filename);
+        xLoc = x;
+        yLoc = y;
+        wDim = w;
+        hDim = h;
+    }
+
+    VisualComponent::VisualComponent(VisualComponent&& other) noexcept = default;
+
+    VisualComponent& VisualComponent::operator=(VisualComponent&& other) noexcept = default;
+}
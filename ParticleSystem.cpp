@@ -0,0 +1,194 @@
+#include "ParticleSystem.h"
+#include <cfloat>
+#include <cmath>
+
+ParticleSystem::ParticleSystem(const float2& gravity, float restitution, unsigned int substeps)
+    : gravity{ gravity }, restitution{ restitution }, substeps{ substeps > 0 ? substeps : 1 } {}
+
+void ParticleSystem::spawn(const float2& location, const float2& velocity, float particleLife) {
+    x.push_back(location.x);
+    y.push_back(location.y);
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    life.push_back(particleLife);
+}
+
+void ParticleSystem::addBox(const float2& low, const float2& high) {
+    boxes.push_back(Box{ low,high });
+}
+
+void ParticleSystem::clearCapsules() {
+    capsules.clear();
+}
+
+void ParticleSystem::addCapsule(const float2& p1, const float2& p2, float radius, const float2& velocity) {
+    capsules.push_back(Capsule{ p1,p2,radius,velocity });
+}
+
+void ParticleSystem::clear() {
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+    life.clear();
+}
+
+void ParticleSystem::tick() {
+    size_t first = 0;
+#ifdef VECTOR_MATH_SSE
+    for (; first + 4 <= x.size(); first += 4)
+        moveFourParticles(first);
+#endif
+    for (; first < x.size(); ++first)
+        moveParticle(first);
+
+    // Dead particles are replaced by the last one, so the arrays stay packed
+    for (size_t i = 0; i < x.size();) {
+        if (life[i] > 0) {
+            ++i;
+            continue;
+        }
+        for (auto array : { &x,&y,&vx,&vy,&life }) {
+            (*array)[i] = array->back();
+            array->pop_back();
+        }
+    }
+}
+
+// The same as moveFourParticles, for one particle at a time
+void ParticleSystem::moveParticle(size_t i) {
+    float dt = 1.0f / substeps;
+    float2 location = { x[i],y[i] };
+    float2 velocity = { vx[i],vy[i] };
+    for (unsigned int step = 0; step < substeps; ++step) {
+        velocity += gravity * dt;
+        location += velocity * dt;
+
+        // Pushed out of a box through the nearest side
+        for (auto& box : boxes) {
+            if (!(location.x > box.low.x && location.x < box.high.x && location.y > box.low.y && location.y < box.high.y))
+                continue;
+            float left = location.x - box.low.x;
+            float right = box.high.x - location.x;
+            float bottom = location.y - box.low.y;
+            float top = box.high.y - location.y;
+            if (fminf(left, right) < fminf(bottom, top)) {
+                location.x = left < right ? box.low.x : box.high.x;
+                velocity.x = left < right ? -fabs(velocity.x) * restitution : fabs(velocity.x) * restitution;
+            }
+            else {
+                location.y = bottom < top ? box.low.y : box.high.y;
+                velocity.y = bottom < top ? -fabs(velocity.y) * restitution : fabs(velocity.y) * restitution;
+            }
+        }
+
+        // Pushed out of a capsule away from the nearest point on its line
+        for (auto& capsule : capsules) {
+            float2 direction = capsule.p2 - capsule.p1;
+            float lengthSq = dotProduct(direction, direction);
+            float2 toLocation = location - capsule.p1;
+            float t = lengthSq > 0 ? fminf(fmaxf(dotProduct(toLocation, direction) / lengthSq, 0.0f), 1.0f) : 0.0f;
+            float2 fromLine = toLocation - direction * t;
+            float distanceSq = dotProduct(fromLine, fromLine);
+            if (!(distanceSq < capsule.radius * capsule.radius))
+                continue;
+            float2 normal = distanceSq >= FLT_MIN ? fromLine / sqrt(distanceSq) : float2{ 0.0f,1.0f }; // The same cut off as with SSE
+            location = capsule.p1 + direction * t + normal * capsule.radius;
+            float speed = dotProduct(velocity - capsule.velocity, normal);
+            if (speed < 0)
+                velocity -= normal * ((1 + restitution) * speed);
+        }
+    }
+    x[i] = location.x;
+    y[i] = location.y;
+    vx[i] = velocity.x;
+    vy[i] = velocity.y;
+    life[i] -= 1.0f;
+}
+
+#ifdef VECTOR_MATH_SSE
+// a where mask is set, otherwise b
+static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Moves particles first to first + 3 together, without branching on any one of them
+void ParticleSystem::moveFourParticles(size_t first) {
+    const __m128 dt = _mm_set1_ps(1.0f / substeps);
+    const __m128 gravityX = _mm_set1_ps(gravity.x / substeps);
+    const __m128 gravityY = _mm_set1_ps(gravity.y / substeps);
+    const __m128 bounce = _mm_set1_ps(restitution);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    __m128 px = _mm_loadu_ps(&x[first]);
+    __m128 py = _mm_loadu_ps(&y[first]);
+    __m128 pvx = _mm_loadu_ps(&vx[first]);
+    __m128 pvy = _mm_loadu_ps(&vy[first]);
+    for (unsigned int step = 0; step < substeps; ++step) {
+        pvx = _mm_add_ps(pvx, gravityX);
+        pvy = _mm_add_ps(pvy, gravityY);
+        px = _mm_add_ps(px, _mm_mul_ps(pvx, dt));
+        py = _mm_add_ps(py, _mm_mul_ps(pvy, dt));
+
+        for (auto& box : boxes) {
+            __m128 lowX = _mm_set1_ps(box.low.x);
+            __m128 lowY = _mm_set1_ps(box.low.y);
+            __m128 highX = _mm_set1_ps(box.high.x);
+            __m128 highY = _mm_set1_ps(box.high.y);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(px, lowX), _mm_cmplt_ps(px, highX)),
+                _mm_and_ps(_mm_cmpgt_ps(py, lowY), _mm_cmplt_ps(py, highY)));
+            if (!_mm_movemask_ps(inside))
+                continue;
+            __m128 left = _mm_sub_ps(px, lowX);
+            __m128 right = _mm_sub_ps(highX, px);
+            __m128 bottom = _mm_sub_ps(py, lowY);
+            __m128 top = _mm_sub_ps(highY, py);
+            __m128 throughX = _mm_and_ps(inside, _mm_cmplt_ps(_mm_min_ps(left, right), _mm_min_ps(bottom, top)));
+            __m128 throughY = _mm_andnot_ps(throughX, inside);
+            __m128 toLeft = _mm_cmplt_ps(left, right);
+            __m128 toBottom = _mm_cmplt_ps(bottom, top);
+            __m128 speedX = _mm_mul_ps(_mm_andnot_ps(signBit, pvx), bounce);
+            __m128 speedY = _mm_mul_ps(_mm_andnot_ps(signBit, pvy), bounce);
+            px = select(throughX, select(toLeft, lowX, highX), px);
+            pvx = select(throughX, select(toLeft, _mm_or_ps(speedX, signBit), speedX), pvx);
+            py = select(throughY, select(toBottom, lowY, highY), py);
+            pvy = select(throughY, select(toBottom, _mm_or_ps(speedY, signBit), speedY), pvy);
+        }
+
+        for (auto& capsule : capsules) {
+            float2 direction = capsule.p2 - capsule.p1;
+            float lengthSq = dotProduct(direction, direction);
+            __m128 p1x = _mm_set1_ps(capsule.p1.x);
+            __m128 p1y = _mm_set1_ps(capsule.p1.y);
+            __m128 dx = _mm_set1_ps(direction.x);
+            __m128 dy = _mm_set1_ps(direction.y);
+            __m128 radius = _mm_set1_ps(capsule.radius);
+            __m128 toX = _mm_sub_ps(px, p1x);
+            __m128 toY = _mm_sub_ps(py, p1y);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(toX, dx), _mm_mul_ps(toY, dy)), _mm_set1_ps(lengthSq > 0 ? 1 / lengthSq : 0.0f));
+            t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            __m128 nx = _mm_sub_ps(toX, _mm_mul_ps(dx, t));
+            __m128 ny = _mm_sub_ps(toY, _mm_mul_ps(dy, t));
+            __m128 distanceSq = _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny));
+            __m128 hit = _mm_cmplt_ps(distanceSq, _mm_mul_ps(radius, radius));
+            if (!_mm_movemask_ps(hit))
+                continue;
+            __m128 apart = _mm_cmpge_ps(distanceSq, _mm_set1_ps(FLT_MIN)); // reciprocalSqrt can't take denormals
+            __m128 inverseDistance = reciprocalSqrt(distanceSq);
+            nx = select(apart, _mm_mul_ps(nx, inverseDistance), _mm_setzero_ps());
+            ny = select(apart, _mm_mul_ps(ny, inverseDistance), _mm_set1_ps(1.0f));
+            px = select(hit, _mm_add_ps(_mm_add_ps(p1x, _mm_mul_ps(dx, t)), _mm_mul_ps(nx, radius)), px);
+            py = select(hit, _mm_add_ps(_mm_add_ps(p1y, _mm_mul_ps(dy, t)), _mm_mul_ps(ny, radius)), py);
+            __m128 speed = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(pvx, _mm_set1_ps(capsule.velocity.x)), nx),
+                _mm_mul_ps(_mm_sub_ps(pvy, _mm_set1_ps(capsule.velocity.y)), ny));
+            __m128 change = _mm_and_ps(_mm_and_ps(hit, _mm_cmplt_ps(speed, _mm_setzero_ps())), _mm_mul_ps(speed, _mm_set1_ps(1 + restitution)));
+            pvx = _mm_sub_ps(pvx, _mm_mul_ps(nx, change));
+            pvy = _mm_sub_ps(pvy, _mm_mul_ps(ny, change));
+        }
+    }
+    _mm_storeu_ps(&x[first], px);
+    _mm_storeu_ps(&y[first], py);
+    _mm_storeu_ps(&vx[first], pvx);
+    _mm_storeu_ps(&vy[first], pvy);
+    _mm_storeu_ps(&life[first], _mm_sub_ps(_mm_loadu_ps(&life[first]), _mm_set1_ps(1.0f)));
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "VectorMath.h"
+
+// Large numbers of small things, e.g. fragments of broken blocks, moved in fixed steps instead of by the collision queue.
+// They bounce off the boxes and capsules they are given, but nothing is affected by them in return
+class ParticleSystem {
+	// A solid rectangle, e.g. a wall
+	struct Box {
+		float2 low; // Bottom left corner
+		float2 high; // Top right corner
+	};
+
+	// A line with rounded ends of the given radius, e.g. the bat. Moves at velocity, for bouncing particles off it properly
+	struct Capsule {
+		float2 p1;
+		float2 p2;
+		float radius;
+		float2 velocity;
+	};
+
+	// Each property is kept in its own array, so that four particles at a time can be moved with SSE
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> life; // Ticks left before the particle disappears
+	std::vector<Box> boxes;
+	std::vector<Capsule> capsules;
+	float2 gravity; // Change in velocity each tick
+	float restitution; // Fraction of the speed into a surface that a particle bounces off it with
+	unsigned int substeps; // Steps each tick is split into, so that fast particles don't pass through thin things
+
+	void moveParticle(size_t i);
+	void moveFourParticles(size_t first);
+public:
+	ParticleSystem(const float2& gravity, float restitution, unsigned int substeps);
+	// 'life' is in ticks
+	void spawn(const float2& location, const float2& velocity, float life);
+	void addBox(const float2& low, const float2& high);
+	// Capsules are for things that move, so they are all removed and given again each tick
+	void clearCapsules();
+	void addCapsule(const float2& p1, const float2& p2, float radius, const float2& velocity);
+	// Moves every particle forward one tick, and removes those which have run out of life
+	void tick();
+	void clear();
+	size_t size() const { return x.size(); }
+	// Locations of the particles, as arrays of size() x and y coordinates
+	const float* getX() const { return x.data(); }
+	const float* getY() const { return y.data(); }
+};
@@ -0,0 +1,100 @@
+#include "Replay.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+// Start of every replay file, then the version of the format
+constexpr unsigned char replayMagic[4] = { 'B','R','P','L' };
+constexpr uint32_t replayVersion = 1;
+// Bits of an event's number taken by the input. The rest are the ticks since the last event
+constexpr unsigned int inputBits = 2;
+
+// Writes 'value' 7 bits at a time, lowest first, with the top bit of each byte set if more follow
+static void writeVarint(std::vector<unsigned char>& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<unsigned char>(value));
+}
+
+static uint64_t readVarint(const std::vector<unsigned char>& bytes, size_t& offset) {
+    uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (offset >= bytes.size())
+            throw "Replay is cut short";
+        unsigned char byte = bytes[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw "Replay has a number that is too long";
+}
+
+static uint32_t readVarint32(const std::vector<unsigned char>& bytes, size_t& offset) {
+    uint64_t value = readVarint(bytes, offset);
+    if (value > UINT32_MAX)
+        throw "Replay has a number that is too big";
+    return static_cast<uint32_t>(value);
+}
+
+std::vector<unsigned char> Replay::encode() const {
+    std::vector<unsigned char> bytes{ std::begin(replayMagic), std::end(replayMagic) };
+    writeVarint(bytes, replayVersion);
+    writeVarint(bytes, seed);
+    writeVarint(bytes, level);
+    writeVarint(bytes, tickCount);
+    writeVarint(bytes, events.size());
+    uint32_t lastTick = 0;
+    for (auto& event : events) {
+        // Most ticks have no inputs, and most inputs are the only one in their tick, so this is usually one or two bytes
+        writeVarint(bytes, (static_cast<uint64_t>(event.tick - lastTick) << inputBits) | static_cast<uint64_t>(event.input));
+        lastTick = event.tick;
+    }
+    return bytes;
+}
+
+Replay Replay::decode(const std::vector<unsigned char>& bytes) {
+    if (bytes.size() < std::size(replayMagic) || !std::equal(std::begin(replayMagic), std::end(replayMagic), bytes.begin()))
+        throw "Not a replay";
+    size_t offset = std::size(replayMagic);
+    if (readVarint32(bytes, offset) != replayVersion)
+        throw "Replay is from a different version";
+
+    Replay replay;
+    replay.seed = readVarint32(bytes, offset);
+    replay.level = readVarint32(bytes, offset);
+    replay.tickCount = readVarint32(bytes, offset);
+    uint64_t eventCount = readVarint(bytes, offset);
+    if (eventCount > bytes.size() - offset) // Each event takes at least a byte
+        throw "Replay is cut short";
+    replay.events.reserve(static_cast<size_t>(eventCount));
+    uint64_t tick = 0;
+    for (uint64_t i = 0; i < eventCount; ++i) {
+        uint64_t packed = readVarint(bytes, offset);
+        tick += packed >> inputBits;
+        if (tick > replay.tickCount)
+            throw "Replay has inputs after its end";
+        replay.events.push_back(ReplayEvent{ static_cast<uint32_t>(tick),static_cast<GameInput>(packed & ((1u << inputBits) - 1)) });
+    }
+    if (offset != bytes.size())
+        throw "Replay has something extra at the end";
+    return replay;
+}
+
+void Replay::save(const std::filesystem::path& path) const {
+    std::vector<unsigned char> bytes = encode();
+    std::ofstream file{ path, std::ios::binary };
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!file)
+        throw "Could not write replay";
+}
+
+Replay Replay::load(const std::filesystem::path& path) {
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+        throw "Could not open replay";
+    std::vector<unsigned char> bytes{ std::istreambuf_iterator<char>{ file },std::istreambuf_iterator<char>{} };
+    return decode(bytes);
+}
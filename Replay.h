@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// The inputs that the game gets from the keyboard
+enum class GameInput : unsigned char {
+	leftPress,
+	rightPress,
+	leftRelease,
+	rightRelease
+};
+
+// An input, and how many ticks had been done when it came
+struct ReplayEvent {
+	uint32_t tick;
+	GameInput input;
+};
+
+// Everything needed to play a game again exactly as it went: how it started, and every input in the order they came. Used for
+// reproducing bugs and as a fixed workload for measuring performance
+struct Replay {
+	uint32_t seed; // For the random numbers that the game uses
+	uint32_t level;
+	uint32_t tickCount; // Ticks the game was run for
+	std::vector<ReplayEvent> events; // In order of tick
+
+	// Compact binary form. Each event is the ticks since the last one and the input, packed into one number of as few bytes as it needs
+	std::vector<unsigned char> encode() const;
+	// Throws if 'bytes' isn't a replay of this version
+	static Replay decode(const std::vector<unsigned char>& bytes);
+	void save(const std::filesystem::path& path) const;
+	static Replay load(const std::filesystem::path& path);
+};
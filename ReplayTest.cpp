@@ -0,0 +1,96 @@
+#include "Game.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+// Checks that a recorded game comes back byte for byte from its replay, through encode and decode and through a file, and that playing
+// the replay through tick() records the same replay and leaves the world exactly as the game did. Also checks that replays which are cut
+// short, from another version or with something extra are turned down. Built with NullDisplaySystem.cpp, so the game can run without a
+// window
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        ++failures;
+        std::fprintf(stderr, "%s\n", what);
+    }
+}
+
+static void checkTurnedDown(const std::vector<unsigned char>& bytes, const char* what) {
+    bool thrown = false;
+    try {
+        Replay::decode(bytes);
+    }
+    catch (const char*) {
+        thrown = true;
+    }
+    check(thrown, what);
+}
+
+int main() {
+    constexpr uint32_t seed = 7;
+    constexpr uint32_t ticks = 5000; // Long enough for the ball to be lost and the game started again
+
+    // Presses and releases left and right at random, sometimes both in the same tick
+    BreakoutGame game{ seed };
+    std::minstd_rand random{ seed };
+    std::uniform_int_distribution<int> choice{ 0,15 };
+    for (uint32_t tick = 0; tick < ticks; ++tick) {
+        int input = choice(random);
+        if (input < 4)
+            game.input(static_cast<GameInput>(input));
+        if (input == 4) {
+            game.input(GameInput::leftRelease);
+            game.input(GameInput::rightPress);
+        }
+        game.tick();
+    }
+    const Replay& replay = game.getReplay();
+    std::vector<unsigned char> bytes = replay.encode();
+
+    Replay decoded = Replay::decode(bytes);
+    check(decoded.seed == seed && decoded.level == BreakoutGame::levelId && decoded.tickCount == ticks, "The header of a replay changed");
+    bool sameEvents = decoded.events.size() == replay.events.size();
+    for (size_t i = 0; sameEvents && i < replay.events.size(); ++i)
+        sameEvents = decoded.events[i].tick == replay.events[i].tick && decoded.events[i].input == replay.events[i].input;
+    check(sameEvents, "The events of a replay changed");
+    check(decoded.encode() == bytes, "A decoded replay encodes to different bytes");
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "breakoutReplayTest.replay";
+    replay.save(path);
+    Replay loaded = Replay::load(path);
+    std::filesystem::remove(path);
+    check(loaded.encode() == bytes, "A replay loaded from a file encodes to different bytes");
+
+    // Played again as playReplay does
+    BreakoutGame replayed{ decoded.seed };
+    size_t next = 0;
+    for (uint32_t tick = 0; tick < decoded.tickCount; ++tick) {
+        for (; next < decoded.events.size() && decoded.events[next].tick == tick; ++next)
+            replayed.input(decoded.events[next].input);
+        replayed.tick();
+    }
+    check(replayed.getReplay().encode() == bytes, "Playing a replay records a different replay");
+    std::vector<unsigned char> expected, played;
+    game.getWorld().snapshot(expected);
+    replayed.getWorld().snapshot(played);
+    check(expected == played, "Playing a replay leaves the world in a different state to the game");
+
+    for (size_t size = 0; size < bytes.size(); ++size)
+        checkTurnedDown(std::vector<unsigned char>(bytes.begin(), bytes.begin() + size), "A replay cut short was decoded");
+    std::vector<unsigned char> longer = bytes;
+    longer.push_back(0);
+    checkTurnedDown(longer, "A replay with something extra at the end was decoded");
+    std::vector<unsigned char> wrongVersion = bytes;
+    ++wrongVersion[4]; // The version follows the 4 byte magic number
+    checkTurnedDown(wrongVersion, "A replay from a different version was decoded");
+
+    if (failures) {
+        std::fprintf(stderr, "%u failures\n", failures);
+        return 1;
+    }
+    std::printf("Replays come back byte for byte and play the game again exactly\n");
+    return 0;
+}
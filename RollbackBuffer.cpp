@@ -0,0 +1,32 @@
+#include "RollbackBuffer.h"
+
+RollbackBuffer::RollbackBuffer(size_t capacity) : frames(capacity), newest{ 0 }, count{ 0 } {
+    if (capacity == 0)
+        throw "Rollback buffer needs room for at least one tick";
+}
+
+void RollbackBuffer::save(const CollisionWorld& world) {
+    newest = (newest + 1) % frames.size();
+    world.saveTickState(frames[newest]);
+    if (count < frames.size())
+        ++count;
+}
+
+void RollbackBuffer::rollback(CollisionWorld& world, size_t ticks) {
+    if (ticks >= count)
+        throw "Not enough ticks saved to roll back that far";
+    size_t frame = (newest + frames.size() - ticks) % frames.size();
+    world.restoreTickState(frames[frame]); // First, so that nothing is forgotten if it throws
+    newest = frame;
+    count -= ticks;
+}
+
+void RollbackBuffer::resimulate(CollisionWorld& world, size_t ticks, const std::function<void(size_t)>& beforeTick) {
+    rollback(world, ticks);
+    for (size_t tick = 0; tick < ticks; ++tick) {
+        if (beforeTick)
+            beforeTick(tick);
+        world.doTickOfCollisions();
+        save(world);
+    }
+}
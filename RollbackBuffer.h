@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "LineAndCircleBoundedCollidable.h"
+
+// Keeps the state of a collision world after each of the last few ticks, so that it can be put back a few ticks and those ticks done
+// again with different inputs, e.g. for netplay when another player's inputs arrive late. Each tick is kept as a CollisionWorld::TickState,
+// which is reused once the ring has gone round, so saving and rolling back don't allocate once every one has grown to fit.
+// Only the world is rolled back, and only what ticks change in it, so no objects can be added, removed or reshaped between the oldest
+// tick kept and a rollback. Game state kept outside the world has to be brought back in step by the game, e.g. with BrickField::matchCells
+// after resimulating. Anything that doesn't affect the world, such as particles, can be left as it is
+class RollbackBuffer {
+	std::vector<CollisionWorld::TickState> frames;
+	size_t newest; // Index into frames of the last tick saved
+	size_t count; // Ticks saved, up to frames.size()
+public:
+	// Keeps up to 'capacity' ticks
+	explicit RollbackBuffer(size_t capacity);
+	// Saves the state of the world as the newest tick, replacing the oldest once full. Should be called after each tick
+	void save(const CollisionWorld& world);
+	// Puts the world back to how it was 'ticks' saves before the newest, and forgets the saves after that one. The objects in the world
+	// must be the ones there when it was saved, see CollisionWorld::restoreTickState
+	void rollback(CollisionWorld& world, size_t ticks);
+	// Rolls back 'ticks' ticks, then does them again, saving each one. beforeTick is called with each tick's number, from 0, before
+	// it is done, for the corrected inputs to be applied
+	void resimulate(CollisionWorld& world, size_t ticks, const std::function<void(size_t)>& beforeTick);
+	size_t size() const { return count; }
+	size_t capacity() const { return frames.size(); }
+	// Bytes taken up by the newest tick saved
+	size_t newestSize() const { return count ? frames[newest].size() : 0; }
+	void clear() { count = 0; }
+};
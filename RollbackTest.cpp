@@ -0,0 +1,102 @@
+#include "Game.h"
+#include "RollbackBuffer.h"
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <vector>
+
+// Checks that rolling a world back 1, 8 and 30 ticks with RollbackBuffer and doing the ticks again with the right inputs puts it exactly
+// where it would have been with the right inputs all along. Each tick is first done with the bat steered the wrong way, as if another
+// player's input had been guessed wrongly, then rolled back and done again. Built with NullDisplaySystem.cpp, so the game's objects can be
+// used without a window
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, size_t ticks) {
+    if (!ok) {
+        ++failures;
+        std::fprintf(stderr, "%s, with rollbacks of %zu ticks\n", what, ticks);
+    }
+}
+
+// The game's level in a closed box, with a few balls and a bat
+struct Level {
+    CollisionWorld world; // First, so that it is destroyed after everything in it
+    ParticleSystem fragments{ { 0.0f,-0.0005f }, 0.5f, 4 };
+    Walls walls{ world };
+    BrickField bricks{ world, Rect{ -0.9f, 0.72f, 1.8f, 0.72f }, 10, 8, 0.9f, 1, fragments, 1 };
+    BatPhysics bat{ world, Rect{ -0.1f, -0.84f, 0.2f, 0.05f } };
+    std::list<BallPhysics> balls;
+
+    Level() {
+        Rect temp = getRect(20, 1, 0, 0, 1.0f);
+        for (Rect rect : { getRect(20, 1, 0, 0, 1.0f), getRect(20, 1, 19, 0, 1.0f), getRect(1, 20, 0, 0, 1.0f, { temp.x + temp.w,1.0f ,2.0f * 18.0f / 20.0f,2.0f }) })
+            walls.add(rect);
+        walls.add(Rect{ -1.0f, -0.9f, 2.0f, 0.1f });
+        walls.bake();
+        for (unsigned int i = 0; i < 3; ++i)
+            balls.emplace_back(world, float2{ -0.6f + 0.4f * i,-0.5f }, float2{ -0.01f + 0.007f * i,-0.01f + 0.003f * i }, 0.025f, 1.0f);
+        world.sortStorageSpatially();
+    }
+
+    // Steers the bat to follow the first ball, as a player would
+    int follow() {
+        float offset = balls.front().getLocation().x - (bat.getLocation().x + bat.getWidth() / 2);
+        return offset > 0.01f ? 1 : offset < -0.01f ? -1 : 0;
+    }
+
+    void addLocations(std::vector<float2>& locations) {
+        for (auto& ball : balls)
+            locations.push_back(ball.getLocation());
+        locations.push_back(bat.getLocation());
+    }
+};
+
+int main() {
+    constexpr size_t ticks = 2000;
+
+    // The right inputs all along
+    std::vector<int> inputs;
+    std::vector<float2> expected;
+    std::vector<unsigned char> expectedEnd;
+    {
+        Level level;
+        for (size_t tick = 0; tick < ticks; ++tick) {
+            inputs.push_back(level.follow());
+            level.bat.steer(inputs.back());
+            level.world.doTickOfCollisions();
+            level.addLocations(expected);
+        }
+        level.world.snapshot(expectedEnd);
+    }
+
+    for (size_t back : { 1, 8, 30 }) {
+        Level level;
+        RollbackBuffer rollback{ back + 1 };
+        std::vector<float2> locations;
+        for (size_t tick = 0; tick < ticks; ++tick) {
+            // Until there are enough ticks saved to roll back, the input is known
+            bool guessed = rollback.size() == rollback.capacity();
+            level.bat.steer(guessed ? -inputs[tick] : inputs[tick]);
+            level.world.doTickOfCollisions();
+            rollback.save(level.world);
+            if (guessed) {
+                rollback.resimulate(level.world, back, [&](size_t redone) { level.bat.steer(inputs[tick + 1 - back + redone]); });
+                level.bricks.matchCells();
+            }
+            level.addLocations(locations);
+        }
+        check(locations.size() == expected.size() && std::memcmp(locations.data(), expected.data(), expected.size() * sizeof(float2)) == 0,
+            "Positions after rolling back differ from those with the right inputs", back);
+        std::vector<unsigned char> end;
+        level.world.snapshot(end);
+        check(end == expectedEnd, "The world after rolling back differs from the one with the right inputs", back);
+    }
+
+    if (failures) {
+        std::fprintf(stderr, "%u failures\n", failures);
+        return 1;
+    }
+    std::printf("Rolling back and doing the ticks again matches having the right inputs\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "Game.h"
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <vector>
+
+// Checks that a world restored from a snapshot carries on bit for bit as it did after the snapshot was taken, both in the world it was
+// taken from and in another one set up the same way, and that restore turns down blobs that are cut short, from another version, or of
+// other objects, without changing the world. Built with NullDisplaySystem.cpp, so the game's objects can be used without a window
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        ++failures;
+        std::fprintf(stderr, "%s\n", what);
+    }
+}
+
+// The game's level in a closed box, with 'ballCount' balls and the bat following the first
+struct Level {
+    CollisionWorld world; // First, so that it is destroyed after everything in it
+    ParticleSystem fragments{ { 0.0f,-0.0005f }, 0.5f, 4 };
+    Walls walls{ world };
+    BrickField bricks{ world, Rect{ -0.9f, 0.72f, 1.8f, 0.72f }, 10, 8, 0.9f, 1, fragments, 1 };
+    BatPhysics bat{ world, Rect{ -0.1f, -0.84f, 0.2f, 0.05f } };
+    std::list<BallPhysics> balls;
+
+    explicit Level(unsigned int ballCount) {
+        Rect temp = getRect(20, 1, 0, 0, 1.0f);
+        for (Rect rect : { getRect(20, 1, 0, 0, 1.0f), getRect(20, 1, 19, 0, 1.0f), getRect(1, 20, 0, 0, 1.0f, { temp.x + temp.w,1.0f ,2.0f * 18.0f / 20.0f,2.0f }) })
+            walls.add(rect);
+        walls.add(Rect{ -1.0f, -0.9f, 2.0f, 0.1f });
+        walls.bake();
+        for (unsigned int i = 0; i < ballCount; ++i)
+            balls.emplace_back(world, float2{ -0.6f + 0.4f * i,-0.5f }, float2{ -0.01f + 0.007f * i,-0.01f + 0.003f * i }, 0.025f, 1.0f);
+        world.sortStorageSpatially();
+    }
+
+    // Does 'ticks' ticks, adding where the balls and bat are after each to 'locations'
+    void run(unsigned int ticks, std::vector<float2>& locations) {
+        for (unsigned int tick = 0; tick < ticks; ++tick) {
+            float offset = balls.front().getLocation().x - (bat.getLocation().x + bat.getWidth() / 2);
+            bat.steer(offset > 0.01f ? 1 : offset < -0.01f ? -1 : 0);
+            world.doTickOfCollisions();
+            for (auto& ball : balls)
+                locations.push_back(ball.getLocation());
+            locations.push_back(bat.getLocation());
+        }
+    }
+};
+
+static bool same(const std::vector<float2>& a, const std::vector<float2>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float2)) == 0;
+}
+
+// Restores 'blob' into 'world', which should turn it down and be left as it was
+static void checkTurnedDown(CollisionWorld& world, const std::vector<unsigned char>& blob, const char* what) {
+    std::vector<unsigned char> before, after;
+    world.snapshot(before);
+    bool thrown = false;
+    try {
+        world.restore(blob);
+    }
+    catch (const char*) {
+        thrown = true;
+    }
+    world.snapshot(after);
+    check(thrown, what);
+    check(before == after, "A snapshot that was turned down changed the world");
+}
+
+int main() {
+    constexpr unsigned int ballCount = 3;
+    constexpr unsigned int ticksBefore = 600; // Long enough for bricks to have been broken
+    constexpr unsigned int ticksAfter = 1200;
+
+    Level level{ ballCount };
+    std::vector<float2> unused;
+    level.run(ticksBefore, unused);
+    std::vector<unsigned char> blob;
+    level.world.snapshot(blob);
+
+    std::vector<float2> uninterrupted;
+    level.run(ticksAfter, uninterrupted);
+    std::vector<unsigned char> endUninterrupted;
+    level.world.snapshot(endUninterrupted);
+
+    // Resumed in the world it was taken from, after that has moved on
+    level.world.restore(blob);
+    std::vector<float2> resumed;
+    level.run(ticksAfter, resumed);
+    std::vector<unsigned char> endResumed;
+    level.world.snapshot(endResumed);
+    check(same(uninterrupted, resumed), "A run resumed from a snapshot differs from the one that carried on");
+    check(endUninterrupted == endResumed, "A run resumed from a snapshot ends in a different state");
+
+    // Resumed in a world that has only been set up
+    Level other{ ballCount };
+    other.world.restore(blob);
+    std::vector<float2> resumedElsewhere;
+    other.run(ticksAfter, resumedElsewhere);
+    check(same(uninterrupted, resumedElsewhere), "A run resumed from a snapshot in another world differs from the one that carried on");
+
+    // Cut short anywhere, including inside the header and the slot table
+    for (size_t size = 0; size < blob.size(); size += size < 64 ? 1 : 97)
+        checkTurnedDown(level.world, std::vector<unsigned char>(blob.begin(), blob.begin() + size), "A snapshot cut short was restored");
+    checkTurnedDown(level.world, std::vector<unsigned char>(blob.begin(), blob.end() - 1), "A snapshot missing its last byte was restored");
+    std::vector<unsigned char> longer = blob;
+    longer.push_back(0);
+    checkTurnedDown(level.world, longer, "A snapshot with something extra at the end was restored");
+
+    std::vector<unsigned char> wrongMagic = blob;
+    wrongMagic[0] ^= 1;
+    checkTurnedDown(level.world, wrongMagic, "Something other than a snapshot was restored");
+    std::vector<unsigned char> wrongVersion = blob;
+    ++wrongVersion[4]; // The version follows the 4 byte magic number
+    checkTurnedDown(level.world, wrongVersion, "A snapshot from a different version was restored");
+
+    // Of fewer and of more objects than the world has
+    Level fewer{ ballCount - 1 };
+    checkTurnedDown(fewer.world, blob, "A snapshot with an object more than the world has was restored");
+    Level more{ ballCount + 1 };
+    checkTurnedDown(more.world, blob, "A snapshot with an object fewer than the world has was restored");
+    // Of the same number of objects, but not the same ones
+    Level replaced{ ballCount };
+    replaced.balls.pop_back();
+    replaced.balls.emplace_back(replaced.world, float2{ 0.0f,-0.5f }, float2{ 0.01f,0.01f }, 0.025f, 1.0f);
+    checkTurnedDown(replaced.world, blob, "A snapshot of objects that have since been replaced was restored");
+
+    if (failures) {
+        std::fprintf(stderr, "%u failures\n", failures);
+        return 1;
+    }
+    std::printf("Snapshots resume bit for bit, and bad ones are turned down\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VECTOR_MATH_SSE
+#endif
+
+// Everything here is in the header so that it can be inlined wherever it is used
+
+// float is used for everything, apart from collision times that float is too imprecise to be sure of
+template <typename Scalar>
+struct Vector2 {
+	Scalar x;
+	Scalar y;
+};
+
+using float2 = Vector2<float>;
+
+// Four floats packed together, lined up so that SSE can load them in one go
+struct alignas(16) float4 {
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+template <typename Scalar>
+constexpr bool operator==(const Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	return (a.x == b.x) && (a.y == b.y);
+}
+
+template <typename Scalar>
+constexpr bool operator!=(const Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	return !(a == b);
+}
+
+// The scalar isn't used to work out the type, so that e.g. 'x / 2' works for a float2
+template <typename Scalar>
+constexpr Vector2<Scalar> operator*(const Vector2<Scalar>& x, std::type_identity_t<Scalar> a) {
+	return { x.x * a,x.y * a };
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar> operator*(std::type_identity_t<Scalar> a, const Vector2<Scalar>& x) {
+	return { x.x * a,x.y * a };
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar> operator/(const Vector2<Scalar>& x, std::type_identity_t<Scalar> a) {
+	return { x.x / a,x.y / a };
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar> operator+(const Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	return { a.x + b.x,a.y + b.y };
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar> operator-(const Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	return { a.x - b.x,a.y - b.y };
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar>& operator+=(Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	a.x += b.x;
+	a.y += b.y;
+	return a;
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar>& operator-=(Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	a.x -= b.x;
+	a.y -= b.y;
+	return a;
+}
+
+template <typename Scalar>
+constexpr Vector2<Scalar> operator-(const Vector2<Scalar>& a) {
+	return { -a.x,-a.y };
+}
+
+template <typename Scalar>
+constexpr Scalar dotProduct(const Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	return a.x * b.x + a.y * b.y;
+}
+
+// Positive if b is anticlockwise from a
+template <typename Scalar>
+constexpr Scalar crossProduct(const Vector2<Scalar>& a, const Vector2<Scalar>& b) {
+	return a.x * b.y - a.y * b.x;
+}
+
+// Returns the zero vector unchanged
+template <typename Scalar>
+Vector2<Scalar> normalise(const Vector2<Scalar>& a) {
+	Scalar lengthSq = dotProduct(a, a);
+	return lengthSq > 0 ? a / std::sqrt(lengthSq) : a;
+}
+
+constexpr float4 operator+(const float4& a, const float4& b) {
+	return { a.x + b.x,a.y + b.y,a.z + b.z,a.w + b.w };
+}
+
+constexpr float4 operator-(const float4& a, const float4& b) {
+	return { a.x - b.x,a.y - b.y,a.z - b.z,a.w - b.w };
+}
+
+constexpr float4 operator*(const float4& x, float a) {
+	return { x.x * a,x.y * a,x.z * a,x.w * a };
+}
+
+struct Matrix2x2 {
+	float xx;
+	float xy;
+	float yx;
+	float yy;
+};
+
+constexpr float2 operator*(const Matrix2x2& a, const float2& x) {
+	return { a.xx * x.x + a.xy * x.y,a.yx * x.x + a.yy * x.y };
+}
+
+constexpr Matrix2x2 operator+(const Matrix2x2& a, const Matrix2x2& b) {
+	return { a.xx + b.xx,a.xy + b.xy,a.yx + b.yx,a.yy + b.yy };
+}
+
+#ifdef VECTOR_MATH_SSE
+// SSE's estimate is only good to about 1 part in 4000, so it is refined with a step of Newton's method to about 1 part in 10^7.
+// Only for normal positive numbers: 0 and denormals give infinity, so anything that might be that small has to be checked first
+inline __m128 reciprocalSqrt(__m128 x) {
+	__m128 estimate = _mm_rsqrt_ps(x);
+	__m128 correction = _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), _mm_mul_ps(estimate, estimate)));
+	return _mm_mul_ps(estimate, correction);
+}
+#endif
+
+// Operations on many vectors at once, given as separate arrays of x and y components. With SSE, four are done at a time, with the same
+// operations in the same order as the functions on single vectors above, so the results are exactly the same either way. Results can be
+// written over the inputs
+
+inline void dotProducts(const float* ax, const float* ay, const float* bx, const float* by, float* result, size_t count) {
+	size_t i = 0;
+#ifdef VECTOR_MATH_SSE
+	for (; i + 4 <= count; i += 4) {
+		__m128 products = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(bx + i)), _mm_mul_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(by + i)));
+		_mm_storeu_ps(result + i, products);
+	}
+#endif
+	for (; i < count; ++i)
+		result[i] = dotProduct(float2{ ax[i],ay[i] }, float2{ bx[i],by[i] });
+}
+
+inline void crossProducts(const float* ax, const float* ay, const float* bx, const float* by, float* result, size_t count) {
+	size_t i = 0;
+#ifdef VECTOR_MATH_SSE
+	for (; i + 4 <= count; i += 4) {
+		__m128 products = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(by + i)), _mm_mul_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(bx + i)));
+		_mm_storeu_ps(result + i, products);
+	}
+#endif
+	for (; i < count; ++i)
+		result[i] = crossProduct(float2{ ax[i],ay[i] }, float2{ bx[i],by[i] });
+}
+
+// 1 / sqrt(x), exactly, so infinity for 0. Slower than reciprocalSqrt, but the same with or without SSE
+inline void reciprocalSqrts(const float* x, float* result, size_t count) {
+	size_t i = 0;
+#ifdef VECTOR_MATH_SSE
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(result + i, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_loadu_ps(x + i))));
+#endif
+	for (; i < count; ++i)
+		result[i] = 1 / std::sqrt(x[i]);
+}
+
+// As normalise on each vector, so vectors too short for their length squared to be above 0 are left as they are
+inline void normalise(float* x, float* y, size_t count) {
+	size_t i = 0;
+#ifdef VECTOR_MATH_SSE
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i);
+		__m128 vy = _mm_loadu_ps(y + i);
+		__m128 lengthSq = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+		__m128 length = _mm_sqrt_ps(lengthSq);
+		__m128 nonZero = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+		_mm_storeu_ps(x + i, _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(vx, length)), _mm_andnot_ps(nonZero, vx)));
+		_mm_storeu_ps(y + i, _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(vy, length)), _mm_andnot_ps(nonZero, vy)));
+	}
+#endif
+	for (; i < count; ++i) {
+		float2 normalised = normalise(float2{ x[i],y[i] });
+		x[i] = normalised.x;
+		y[i] = normalised.y;
+	}
+}
@@ -0,0 +1,101 @@
+#include "VectorMath.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Times the operations on many vectors at once in VectorMath.h against a loop of the single vector versions, on random vectors, and
+// prints the results as JSON so that they can be compared across builds. The results are added into a checksum, which is printed so
+// that the work can't be left out. As both give exactly the same results, their checksums match
+//   -vectors N  Vectors gone through by each operation (default 20000000)
+
+// Vectors in each call. Few enough that they stay in the cache, so that the calculation is what is timed
+constexpr size_t vectorsPerCall = 1024;
+
+struct Inputs {
+    std::vector<float> ax;
+    std::vector<float> ay;
+    std::vector<float> bx;
+    std::vector<float> by;
+};
+
+// Times calls of 'call' on the inputs until 'vectors' have been gone through, and prints the result
+template <typename Call>
+static void run(const char* name, const char* version, const Inputs& inputs, size_t vectors, Call call, bool& first) {
+    std::vector<float> x(vectorsPerCall), y(vectorsPerCall);
+    double checksum = 0;
+    size_t done = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (done < vectors) {
+        // Copied in first, as normalise works in place. The others do the same, so that it costs them the same
+        std::memcpy(x.data(), inputs.ax.data(), vectorsPerCall * sizeof(float));
+        std::memcpy(y.data(), inputs.ay.data(), vectorsPerCall * sizeof(float));
+        call(x.data(), y.data());
+        checksum += x[done / vectorsPerCall % vectorsPerCall] + y[done / vectorsPerCall % vectorsPerCall];
+        done += vectorsPerCall;
+    }
+    std::chrono::duration<double, std::nano> taken = std::chrono::steady_clock::now() - start;
+
+    if (!first)
+        std::printf(",\n");
+    first = false;
+    std::printf("    { \"function\": \"%s\", \"version\": \"%s\", \"vectors\": %zu, \"nsPerVector\": %.3f, \"checksum\": %.9g }", name, version,
+        done, taken.count() / done, checksum);
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    size_t vectors = 20000000;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "-vectors") == 0)
+            vectors = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::fprintf(stderr, "Usage: %s [-vectors N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // On the game's scale, with none zero, so that every vector does the same work
+    Inputs inputs;
+    std::minstd_rand random{ 1 };
+    std::uniform_real_distribution<float> component{ 0.01f,1.0f };
+    for (auto* values : { &inputs.ax, &inputs.ay, &inputs.bx, &inputs.by }) {
+        values->resize(vectorsPerCall);
+        for (auto& value : *values)
+            value = component(random);
+    }
+    const float* bx = inputs.bx.data();
+    const float* by = inputs.by.data();
+    size_t count = inputs.ax.size(); // Not a constant, as it wouldn't be in the game
+
+    std::printf("{\n  \"results\": [\n");
+    bool first = true;
+    // The results go in x, so that they are what the checksum adds up
+    run("dotProducts", "batch", inputs, vectors, [&](float* x, float* y) { dotProducts(x, y, bx, by, x, count); }, first);
+    run("dotProducts", "single", inputs, vectors, [&](float* x, float* y) {
+        for (size_t i = 0; i < count; ++i)
+            x[i] = dotProduct(float2{ x[i],y[i] }, float2{ bx[i],by[i] });
+    }, first);
+    run("crossProducts", "batch", inputs, vectors, [&](float* x, float* y) { crossProducts(x, y, bx, by, x, count); }, first);
+    run("crossProducts", "single", inputs, vectors, [&](float* x, float* y) {
+        for (size_t i = 0; i < count; ++i)
+            x[i] = crossProduct(float2{ x[i],y[i] }, float2{ bx[i],by[i] });
+    }, first);
+    run("reciprocalSqrts", "batch", inputs, vectors, [&](float* x, float*) { reciprocalSqrts(x, x, count); }, first);
+    run("reciprocalSqrts", "single", inputs, vectors, [&](float* x, float*) {
+        for (size_t i = 0; i < count; ++i)
+            x[i] = 1 / std::sqrt(x[i]);
+    }, first);
+    run("normalise", "batch", inputs, vectors, [&](float* x, float* y) { normalise(x, y, count); }, first);
+    run("normalise", "single", inputs, vectors, [&](float* x, float* y) {
+        for (size_t i = 0; i < count; ++i) {
+            float2 normalised = normalise(float2{ x[i],y[i] });
+            x[i] = normalised.x;
+            y[i] = normalised.y;
+        }
+    }, first);
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "VectorMath.h"
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Checks that the operations on many vectors at once give exactly what the ones on single vectors do, for every length up to a few
+// hundred groups of four, so that both the SSE groups and the ones left over at the end are covered. The inputs include zero, denormal
+// and huge vectors, which are where the two could differ. Prints each difference found, and fails if there are any
+
+static unsigned int failures = 0;
+
+static bool same(float a, float b) {
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+static void check(bool ok, const char* what, size_t count, size_t i) {
+    if (!ok && ++failures <= 20)
+        std::fprintf(stderr, "%s differs from the single vector version at %zu of %zu\n", what, i, count);
+}
+
+// A component, mostly on the game's scale, but sometimes one of the cases that needs care
+static float component(std::minstd_rand& random) {
+    std::uniform_real_distribution<float> uniform{ -1.0f,1.0f };
+    switch (random() % 16) {
+    case 0:
+        return 0.0f;
+    case 1:
+        return FLT_MIN * uniform(random) / 4; // Denormal
+    case 2:
+        return 1e-20f * uniform(random); // Squares to a denormal or 0
+    case 3:
+        return 1e20f * uniform(random); // Squares to infinity
+    default:
+        return uniform(random);
+    }
+}
+
+int main() {
+    std::minstd_rand random{ 1 };
+    for (size_t count = 0; count <= 1001; ++count) {
+        std::vector<float> ax(count), ay(count), bx(count), by(count), result(count);
+        for (size_t i = 0; i < count; ++i) {
+            ax[i] = component(random);
+            ay[i] = component(random);
+            bx[i] = component(random);
+            by[i] = component(random);
+            if (random() % 8 == 0) // Zero vectors
+                ax[i] = ay[i] = 0.0f;
+        }
+
+        dotProducts(ax.data(), ay.data(), bx.data(), by.data(), result.data(), count);
+        for (size_t i = 0; i < count; ++i)
+            check(same(result[i], dotProduct(float2{ ax[i],ay[i] }, float2{ bx[i],by[i] })), "dotProducts", count, i);
+
+        crossProducts(ax.data(), ay.data(), bx.data(), by.data(), result.data(), count);
+        for (size_t i = 0; i < count; ++i)
+            check(same(result[i], crossProduct(float2{ ax[i],ay[i] }, float2{ bx[i],by[i] })), "crossProducts", count, i);
+
+        // Written over the input, which they are allowed to be
+        std::vector<float> lengthsSq(count);
+        for (size_t i = 0; i < count; ++i)
+            lengthsSq[i] = std::abs(ax[i]) * (random() % 2 ? std::abs(bx[i]) : 1.0f);
+        result = lengthsSq;
+        reciprocalSqrts(result.data(), result.data(), count);
+        for (size_t i = 0; i < count; ++i)
+            check(same(result[i], 1 / std::sqrt(lengthsSq[i])), "reciprocalSqrts", count, i);
+
+        std::vector<float> x = ax, y = ay;
+        normalise(x.data(), y.data(), count);
+        for (size_t i = 0; i < count; ++i) {
+            float2 expected = normalise(float2{ ax[i],ay[i] });
+            check(same(x[i], expected.x) && same(y[i], expected.y), "normalise", count, i);
+        }
+    }
+
+    float4 a = { 1.0f,-2.0f,0.5f,1024.0f };
+    float4 b = { 0.25f,2.0f,-0.5f,1024.0f };
+    float4 sum = a + b;
+    float4 difference = a - b;
+    float4 scaled = a * 3.0f;
+    check(sum.x == 1.25f && sum.y == 0.0f && sum.z == 0.0f && sum.w == 2048.0f, "float4 +", 4, 0);
+    check(difference.x == 0.75f && difference.y == -4.0f && difference.z == 1.0f && difference.w == 0.0f, "float4 -", 4, 0);
+    check(scaled.x == 3.0f && scaled.y == -6.0f && scaled.z == 1.5f && scaled.w == 3072.0f, "float4 *", 4, 0);
+    check(alignof(float4) == 16 && sizeof(float4) == 16, "float4 layout", 4, 0);
+
+    if (failures) {
+        std::fprintf(stderr, "%u differences\n", failures);
+        return 1;
+    }
+    std::printf("All batch operations match the single vector versions\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "WorldBatchRunner.h"
+#include <algorithm>
+#include "LineAndCircleBoundedCollidable.h"
+
+WorldBatchRunner::WorldBatchRunner(unsigned int threadCount)
+    : task{ nullptr }, taskCount{ 0 }, nextIndex{ 0 }, unfinished{ 0 }, stopping{ false } {
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        threads.emplace_back(&WorldBatchRunner::work, this);
+}
+
+WorldBatchRunner::~WorldBatchRunner() {
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void WorldBatchRunner::work() {
+    std::unique_lock<std::mutex> lock{ mutex };
+    while (true) {
+        workReady.wait(lock, [this] { return stopping || nextIndex < taskCount; });
+        if (stopping)
+            return;
+
+        // Indices are handed out one at a time, so that a thread that gets a quick world takes another instead of waiting
+        size_t index = nextIndex++;
+        const std::function<void(size_t)>& current = *task;
+        lock.unlock();
+        std::exception_ptr thrown;
+        try {
+            current(index);
+        }
+        catch (...) {
+            thrown = std::current_exception();
+        }
+        lock.lock();
+        if (thrown && !error)
+            error = thrown;
+        if (--unfinished == 0)
+            workDone.notify_all();
+    }
+}
+
+void WorldBatchRunner::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0)
+        return;
+    std::unique_lock<std::mutex> lock{ mutex };
+    this->task = &task;
+    taskCount = count;
+    nextIndex = 0;
+    unfinished = count;
+    error = nullptr;
+    workReady.notify_all();
+    workDone.wait(lock, [this] { return unfinished == 0; });
+
+    // Nothing is left for threads to take, so they wait for the next batch
+    this->task = nullptr;
+    taskCount = 0;
+    nextIndex = 0;
+    if (error) {
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
+
+void WorldBatchRunner::doTicksOfCollisions(std::span<CollisionWorld* const> worlds) {
+    run(worlds.size(), [&](size_t i) { worlds[i]->doTickOfCollisions(); });
+}
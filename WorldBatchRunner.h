@@ -0,0 +1,42 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+class CollisionWorld;
+
+// Steps many collision worlds at once on a fixed set of threads, e.g. for running many games in one process without a display.
+// Each world is only worked on by one thread at a time, so the objects in a world need nothing extra to be safe, but their
+// callbacks mustn't touch anything shared with other worlds, such as the display
+class WorldBatchRunner {
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	const std::function<void(size_t)>* task; // The batch being run, or null between batches
+	size_t taskCount;
+	size_t nextIndex; // Next index of the batch for a thread to take
+	size_t unfinished;
+	std::exception_ptr error; // The first thing thrown by the batch
+	bool stopping;
+
+	WorldBatchRunner& operator=(const WorldBatchRunner&) = delete;
+	WorldBatchRunner(const WorldBatchRunner&) = delete;
+
+	void work();
+public:
+	// Uses one thread for each core if threadCount is 0
+	explicit WorldBatchRunner(unsigned int threadCount = 0);
+	~WorldBatchRunner();
+	unsigned int getThreadCount() const { return static_cast<unsigned int>(threads.size()); }
+	// Calls task(i) for every i below count, spread over the threads, and returns once they have all finished. If any of them throw,
+	// the rest still run and the first thing thrown is thrown again from here. Should only be called from one thread at a time
+	void run(size_t count, const std::function<void(size_t)>& task);
+	// Does a tick of collisions in every world. Each world should only be in the list once
+	void doTicksOfCollisions(std::span<CollisionWorld* const> worlds);
+};